@@ -0,0 +1,103 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "ConfigFile.h"
+
+// Longest line of a configuration file
+#define LINE_LENGTH_MAX 256
+
+/***********************************************************************************************************************
+ * Strip white space from both ends of a string
+ **********************************************************************************************************************/
+static char *ConfigFileTrim(char *string)
+{
+  char *end;
+
+  while(isspace((unsigned char)*string)) {
+    string++;
+  }
+  end = string + strlen(string);
+  while((end > string) && isspace((unsigned char)end[-1])) {
+    end--;
+  }
+  *end = 0;
+
+  return string;
+}
+
+/***********************************************************************************************************************
+ * Read a configuration file of "key = value" lines and pass the settings to the handler. Empty lines and lines
+ * starting with '#' are skipped.
+ * Returns false if the file cannot be read or contains an invalid line.
+ **********************************************************************************************************************/
+bool ConfigFileRead(const char *name, ConfigFileHandlerType handler, void *ctx)
+{
+  char line[LINE_LENGTH_MAX];
+  unsigned lineNr = 0;
+  bool retval = false;
+  FILE *file;
+
+  if((file = fopen(name, "r")) == NULL) {
+    perror(name);
+    goto exit;
+  }
+
+  while(fgets(line, sizeof(line), file) != NULL) {
+    char *key = ConfigFileTrim(line);
+    char *separator;
+
+    lineNr++;
+    if((*key == 0) || (*key == '#')) {
+      continue;
+    }
+    if((separator = strchr(key, '=')) == NULL) {
+      fprintf(stderr, "%s:%u: Missing '='\n", name, lineNr);
+      goto close;
+    }
+    *separator = 0;
+    key = ConfigFileTrim(key);
+    if(!handler(ctx, key, ConfigFileTrim(separator + 1))) {
+      fprintf(stderr, "%s:%u: Invalid setting '%s'\n", name, lineNr, key);
+      goto close;
+    }
+  }
+  retval = !ferror(file);
+
+  close:
+  fclose(file);
+  exit:
+  return retval;
+}
@@ -0,0 +1,155 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "PulseClass.h"
+#include "DecodeAutomaton.h"
+
+/***********************************************************************************************************************
+ * Find the transition of a state for an input symbol. Rules with AUTOMATON_AGAIN are followed to the state that
+ * processes the pulse again. The stream flags are tracked for both stream states, a stream ended on the way stays
+ * ended.
+ **********************************************************************************************************************/
+static AutomatonTransitionType AutomatonCompile(const AutomatonType *automaton, uint8_t state, unsigned symbol)
+{
+  AutomatonTransitionType transition = { .next = state, .bit = { 0, 0 }, .keep = BIT_IN_STREAM, .set = 0 };
+  BitType inStream[2] = { 0, BIT_IN_STREAM };
+  unsigned depth = 0;
+  bool again;
+
+  do {
+    const AutomatonRuleType *rule = NULL;
+    uint8_t polarity = (symbol & 1) ? AUTOMATON_MARK : AUTOMATON_SPACE;
+
+    for(size_t r = 0; r < automaton->ruleCount; r++) {
+      const AutomatonRuleType *candidate = &automaton->rules[r];
+      if((candidate->state == transition.next) && (candidate->polarity & polarity) &&
+         ((candidate->window == AUTOMATON_ANY_LENGTH) || (symbol & (2 << candidate->window)))) {
+        rule = candidate;
+        break;
+      }
+    }
+    // Every state needs a rule for any pulse, and rechecking must come to an end
+    if((rule == NULL) || (rule->next >= automaton->stateCount) || (++depth > automaton->stateCount)) {
+      fprintf(stderr, "Invalid bit decoder automaton in state %u\n", transition.next);
+      exit(EXIT_FAILURE);
+    }
+
+    for(unsigned s = 0; s < 2; s++) {
+      if(rule->action & AUTOMATON_END) {
+        transition.bit[s] = inStream[s] ? BIT_END : transition.bit[s];
+        inStream[s] = 0;
+      }
+      else if(rule->action & (AUTOMATON_ZERO | AUTOMATON_ONE)) {
+        transition.bit[s] = ((rule->action & AUTOMATON_ONE) ? BIT_ONE : BIT_ZERO) | BIT_VALID | inStream[s];
+        inStream[s] = BIT_IN_STREAM;
+      }
+    }
+    transition.next = rule->next;
+    again = rule->action & AUTOMATON_AGAIN;
+  } while(again);
+
+  // A stream is either kept, started or ended
+  transition.keep = inStream[0] ? 0 : inStream[1];
+  transition.set = inStream[0];
+
+  return transition;
+}
+
+/***********************************************************************************************************************
+ * Register the length windows as pulse classes, build the transition table and reset the automaton. Pulses shorter
+ * than validMin are ignored.
+ **********************************************************************************************************************/
+void AutomatonInit(AutomatonContext *ctx, const AutomatonType *automaton, const AutomatonWindowType *windows,
+  uint32_t validMin)
+{
+  if((automaton->stateCount > AUTOMATON_MAX_STATES) || (automaton->windowCount > AUTOMATON_MAX_WINDOWS)) {
+    fprintf(stderr, "Bit decoder automaton too large\n");
+    exit(EXIT_FAILURE);
+  }
+
+  ctx->validClass = PulseClassAdd(validMin, PULSE_CLASS_UNLIMITED);
+  for(uint8_t w = 0; w < automaton->windowCount; w++) {
+    ctx->classes[w] = PulseClassAdd(windows[w].min, windows[w].max);
+  }
+  ctx->windowCount = automaton->windowCount;
+
+  for(uint8_t state = 0; state < automaton->stateCount; state++) {
+    for(unsigned symbol = 0; symbol < (2u << automaton->windowCount); symbol++) {
+      ctx->transitions[state][symbol] = AutomatonCompile(automaton, state, symbol);
+    }
+  }
+
+  ctx->state = 0;
+  ctx->inStream = 0;
+}
+
+/***********************************************************************************************************************
+ * Run the automaton with one pulse
+ **********************************************************************************************************************/
+BitType AutomatonDecode(AutomatonContext *ctx, const PulseType *pulse)
+{
+  const AutomatonTransitionType *transition;
+  // Return Value
+  BitType bit = 0;
+  unsigned symbol;
+
+  // Receiver timeout ends the stream right away
+  if(pulse->kind & PULSE_TIMEOUT) {
+    bit = ctx->inStream ? BIT_END : 0;
+    ctx->inStream = 0;
+    ctx->state = 0;
+    goto exit;
+  }
+
+  // Low pass filter
+  if(!(pulse->classes & ctx->validClass)) {
+    goto exit;
+  }
+
+  // Input symbol: polarity and the matching windows
+  symbol = (pulse->kind & PULSE_MARK) ? 1 : 0;
+  for(uint8_t w = 0; w < ctx->windowCount; w++) {
+    symbol |= ((pulse->classes & ctx->classes[w]) != 0) << (w + 1);
+  }
+
+  transition = &ctx->transitions[ctx->state][symbol];
+  bit = transition->bit[ctx->inStream ? 1 : 0];
+  ctx->inStream = (ctx->inStream & transition->keep) | transition->set;
+  ctx->state = transition->next;
+
+  exit:
+  return bit;
+}
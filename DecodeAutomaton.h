@@ -0,0 +1,121 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef DECODE_AUTOMATON_H_
+#define DECODE_AUTOMATON_H_
+
+#include "types.h"
+
+// Limits of an automaton
+#define AUTOMATON_MAX_STATES      8
+#define AUTOMATON_MAX_WINDOWS     6
+// Input symbols: polarity and one bit per matching length window
+#define AUTOMATON_SYMBOLS         (2 << AUTOMATON_MAX_WINDOWS)
+
+// Pulse polarity a rule applies to
+#define AUTOMATON_SPACE           1
+#define AUTOMATON_MARK            2
+#define AUTOMATON_ANY             (AUTOMATON_SPACE | AUTOMATON_MARK)
+// Window of a rule matching every pulse length
+#define AUTOMATON_ANY_LENGTH      0xFF
+
+// Rule actions
+#define AUTOMATON_KEEP            0
+// Emit a bit in the stream
+#define AUTOMATON_ZERO            1
+#define AUTOMATON_ONE             2
+// End the stream
+#define AUTOMATON_END             4
+// The next state processes the same pulse again
+#define AUTOMATON_AGAIN           8
+
+// Length window in us
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+} AutomatonWindowType;
+
+// Rule of a state, the first matching rule of a state wins
+typedef struct {
+  // State the rule belongs to
+  uint8_t state;
+  // Pulse polarity and length window index (AUTOMATON_ANY_LENGTH for all lengths)
+  uint8_t polarity;
+  uint8_t window;
+  // State after the pulse
+  uint8_t next;
+  // Action
+  uint8_t action;
+} AutomatonRuleType;
+
+// Bit encoding as state transition rules
+typedef struct {
+  // Number of states, the first one is the initial state
+  uint8_t stateCount;
+  // Number of length windows in the timing
+  uint8_t windowCount;
+  // Rules, every state must end with a rule for any pulse
+  const AutomatonRuleType *rules;
+  size_t ruleCount;
+} AutomatonType;
+
+// Compiled transition
+typedef struct {
+  // Next state
+  uint8_t next;
+  // Emitted bit outside and inside a stream
+  BitType bit[2];
+  // New stream flag: (inStream & keep) | set
+  BitType keep;
+  BitType set;
+} AutomatonTransitionType;
+
+// Automaton context
+typedef struct {
+  // Pulse classes of the length windows and of all pulses not to be ignored
+  PulseClassType classes[AUTOMATON_MAX_WINDOWS];
+  PulseClassType validClass;
+  uint8_t windowCount;
+  // Transition table indexed by state and input symbol
+  AutomatonTransitionType transitions[AUTOMATON_MAX_STATES][AUTOMATON_SYMBOLS];
+  // Actual state
+  uint8_t state;
+  // Are bits in a stream (no interruptions between)
+  BitType inStream;
+} AutomatonContext;
+
+void AutomatonInit(AutomatonContext *ctx, const AutomatonType *automaton, const AutomatonWindowType *windows,
+  uint32_t validMin);
+BitType AutomatonDecode(AutomatonContext *ctx, const PulseType *pulse);
+
+#endif //DECODE_AUTOMATON_H_
@@ -0,0 +1,105 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "DecodeBiphaseMark.h"
+
+// States: number of one halves received
+enum {
+  NoHalf,
+  OneHalf
+};
+
+// Length windows
+enum {
+  FullWindow,
+  HalfWindow,
+  WindowCount
+};
+
+// A full bit is a zero, two half bits are a one. Both levels carry bits.
+static const AutomatonRuleType biphaseMarkRules[] = {
+  { NoHalf,  AUTOMATON_ANY, FullWindow,           NoHalf,  AUTOMATON_ZERO },
+  { NoHalf,  AUTOMATON_ANY, HalfWindow,           OneHalf, AUTOMATON_KEEP },
+  { NoHalf,  AUTOMATON_ANY, AUTOMATON_ANY_LENGTH, NoHalf,  AUTOMATON_END },
+  { OneHalf, AUTOMATON_ANY, FullWindow,           NoHalf,  AUTOMATON_ZERO },
+  { OneHalf, AUTOMATON_ANY, HalfWindow,           NoHalf,  AUTOMATON_ONE },
+  { OneHalf, AUTOMATON_ANY, AUTOMATON_ANY_LENGTH, NoHalf,  AUTOMATON_END }
+};
+
+static const AutomatonType biphaseMarkAutomaton = {
+  .stateCount = 2,
+  .windowCount = WindowCount,
+  .rules = biphaseMarkRules,
+  .ruleCount = sizeof(biphaseMarkRules) / sizeof(biphaseMarkRules[0])
+};
+
+/***********************************************************************************************************************
+ * Register the thresholds as pulse classes and reset the decoder
+ **********************************************************************************************************************/
+void DecodeBiphaseMarkInit(BiphaseMarkContext *ctx, const BiphaseMarkTiming *timing)
+{
+  const AutomatonWindowType windows[WindowCount] = {
+    [FullWindow] = { timing->fullMin, timing->fullMax },
+    [HalfWindow] = { timing->halfMin, timing->halfMax }
+  };
+
+  AutomatonInit(&ctx->automaton, &biphaseMarkAutomaton, windows, timing->halfMin);
+}
+
+/***********************************************************************************************************************
+ * Biphase Mark Decoder
+ **********************************************************************************************************************/
+BitType DecodeBiphaseMark(BiphaseMarkContext *ctx, const PulseType *pulse)
+{
+  return AutomatonDecode(&ctx->automaton, pulse);
+}
+
+/***********************************************************************************************************************
+ * Generic bit decoder interface
+ **********************************************************************************************************************/
+static void BiphaseMarkInit(void *ctx, const void *timing)
+{
+  DecodeBiphaseMarkInit(ctx, timing);
+}
+
+static BitType BiphaseMarkDecode(void *ctx, const PulseType *pulse)
+{
+  return DecodeBiphaseMark(ctx, pulse);
+}
+
+const BitDecoderType biphaseMarkBitDecoder = {
+  .contextSize = sizeof(BiphaseMarkContext),
+  .timingSize = sizeof(BiphaseMarkTiming),
+  .init = BiphaseMarkInit,
+  .decode = BiphaseMarkDecode
+};
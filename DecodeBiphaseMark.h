@@ -0,0 +1,62 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef DECODE_BIPHASE_MARK_H_
+#define DECODE_BIPHASE_MARK_H_
+
+#include "types.h"
+#include "Protocol.h"
+#include "DecodeAutomaton.h"
+
+// Biphase mark decoder timing
+typedef struct {
+  // Thresholds for a full bit (zero)
+  uint32_t fullMin;
+  uint32_t fullMax;
+  // Thresholds for a half bit (one half of a one)
+  uint32_t halfMin;
+  uint32_t halfMax;
+} BiphaseMarkTiming;
+
+// Biphase mark decoder context
+typedef struct {
+  AutomatonContext automaton;
+} BiphaseMarkContext;
+
+void DecodeBiphaseMarkInit(BiphaseMarkContext *ctx, const BiphaseMarkTiming *timing);
+BitType DecodeBiphaseMark(BiphaseMarkContext *ctx, const PulseType *pulse);
+
+// Generic bit decoder description
+extern const BitDecoderType biphaseMarkBitDecoder;
+
+#endif //DECODE_BIPHASE_MARK_H_
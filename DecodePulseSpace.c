@@ -33,62 +33,77 @@
 
 #include "DecodePulseSpace.h"
 
+// States
+enum {
+  Idle,
+  PulseReceived
+};
+
+// Length windows
+enum {
+  PulseWindow,
+  ZeroWindow,
+  OneWindow,
+  WindowCount
+};
+
+// A pulse followed by a zero or one space
+static const AutomatonRuleType pulseSpaceRules[] = {
+  // No pulse received yet, anything else is not in the stream
+  { Idle,          AUTOMATON_MARK,  PulseWindow,          PulseReceived, AUTOMATON_KEEP },
+  { Idle,          AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, Idle,          AUTOMATON_END },
+  // Pulse received before, a mark of the wrong polarity ends the stream
+  { PulseReceived, AUTOMATON_MARK,  AUTOMATON_ANY_LENGTH, Idle,          AUTOMATON_END },
+  { PulseReceived, AUTOMATON_SPACE, ZeroWindow,           Idle,          AUTOMATON_ZERO },
+  { PulseReceived, AUTOMATON_SPACE, OneWindow,            Idle,          AUTOMATON_ONE },
+  { PulseReceived, AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, Idle,          AUTOMATON_END }
+};
+
+static const AutomatonType pulseSpaceAutomaton = {
+  .stateCount = 2,
+  .windowCount = WindowCount,
+  .rules = pulseSpaceRules,
+  .ruleCount = sizeof(pulseSpaceRules) / sizeof(pulseSpaceRules[0])
+};
+
 /***********************************************************************************************************************
- * Pulse / Space Length Decoder
+ * Register the thresholds as pulse classes and reset the decoder
  **********************************************************************************************************************/
-BitType DecodePulseSpace(PulseSpaceContext *ctx, uint32_t pulseLength)
+void DecodePulseSpaceInit(PulseSpaceContext *ctx, const PulseSpaceTiming *timing)
 {
-  // Return Value
-  BitType bit = 0;
+  const AutomatonWindowType windows[WindowCount] = {
+    [PulseWindow] = { timing->pulseMin, timing->pulseMax },
+    [ZeroWindow]  = { timing->zeroMin, timing->zeroMax },
+    [OneWindow]   = { timing->oneMin, timing->oneMax }
+  };
 
-  // Low pass filter
-  if(pulseLength < ctx->pulseMin) {
-    goto exit;
-  }
-
-  // Bit reception state machine
-  switch(ctx->state) {
-    // No pulse received yet
-    case Idle: {
-      // Check for pulse
-      if(pulseLength <= ctx->pulseMax) {
-        ctx->state = PulseReceived;
-      }
-      // else Following bit not in stream
-      else {
-        ctx->inStream = 0;
-      }
-    }
-    break;
-
-    // Pulse received before
-    case PulseReceived: {
-      // check for zero
-      if((pulseLength >= ctx->zeroMin) && (pulseLength <= ctx->zeroMax)) {
-        bit = BIT_ZERO | BIT_VALID | (ctx->inStream);
-        ctx->inStream = BIT_IN_STREAM;
-      }
-      // else check for one
-      else if((pulseLength >= ctx->oneMin) && (pulseLength <= ctx->oneMax)) {
-        bit = BIT_ONE | BIT_VALID | (ctx->inStream);
-        ctx->inStream = BIT_IN_STREAM;
-      }
-      // else Following bit not in stream
-      else {
-        ctx->inStream = 0;
-      }
+  AutomatonInit(&ctx->automaton, &pulseSpaceAutomaton, windows, timing->pulseMin);
+}
 
-      ctx->state = Idle;
-    }
-    break;
+/***********************************************************************************************************************
+ * Pulse / Space Length Decoder
+ **********************************************************************************************************************/
+BitType DecodePulseSpace(PulseSpaceContext *ctx, const PulseType *pulse)
+{
+  return AutomatonDecode(&ctx->automaton, pulse);
+}
 
-    // Invalid state (should not happen)
-    default: {
-      ctx->state = Idle;
-    }
-    break;
-  }
+/***********************************************************************************************************************
+ * Generic bit decoder interface
+ **********************************************************************************************************************/
+static void PulseSpaceInit(void *ctx, const void *timing)
+{
+  DecodePulseSpaceInit(ctx, timing);
+}
 
-  exit:
-  return bit;
+static BitType PulseSpaceDecode(void *ctx, const PulseType *pulse)
+{
+  return DecodePulseSpace(ctx, pulse);
 }
+
+const BitDecoderType pulseSpaceBitDecoder = {
+  .contextSize = sizeof(PulseSpaceContext),
+  .timingSize = sizeof(PulseSpaceTiming),
+  .init = PulseSpaceInit,
+  .decode = PulseSpaceDecode
+};
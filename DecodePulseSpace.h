@@ -35,8 +35,10 @@
 #define DECODE_PULSE_SPACE_H_
 
 #include "types.h"
+#include "Protocol.h"
+#include "DecodeAutomaton.h"
 
-// Pulse space decoder context
+// Pulse space decoder timing
 typedef struct {
   // Thresholds for a pulse
   uint32_t pulseMin;
@@ -47,15 +49,24 @@ typedef struct {
   // Thresholds for a one space
   uint32_t oneMin;
   uint32_t oneMax;
-  // Internal State
-  enum {
-    Idle,
-    PulseReceived
-  } state;
-  // Are bits in a stream (no interruptions between)
-  BitType inStream;
+} PulseSpaceTiming;
+
+// Timing from the nominal pulse, zero space and one space lengths with a common tolerance
+#define PULSE_SPACE_TIMING(pulse, zero, one, tolerance) { \
+  .pulseMin = (pulse) - (tolerance), .pulseMax = (pulse) + (tolerance), \
+  .zeroMin  = (zero)  - (tolerance), .zeroMax  = (zero)  + (tolerance), \
+  .oneMin   = (one)   - (tolerance), .oneMax   = (one)   + (tolerance)  \
+}
+
+// Pulse space decoder context
+typedef struct {
+  AutomatonContext automaton;
 } PulseSpaceContext;
 
-BitType DecodePulseSpace(PulseSpaceContext *ctx, uint32_t pulseLength);
+void DecodePulseSpaceInit(PulseSpaceContext *ctx, const PulseSpaceTiming *timing);
+BitType DecodePulseSpace(PulseSpaceContext *ctx, const PulseType *pulse);
+
+// Generic bit decoder description
+extern const BitDecoderType pulseSpaceBitDecoder;
 
 #endif //DECODE_PULSE_SPACE_H_
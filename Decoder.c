@@ -0,0 +1,590 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "PulseClass.h"
+#include "Decoder.h"
+#include "wt440h.h"
+#include "auriol.h"
+#include "rf_tech.h"
+#include "mebus.h"
+#include "ws1700.h"
+#include "gt9000.h"
+
+// All compiled in protocols
+static const ProtocolType *const protocols[] = {
+#ifdef MODULE_WT440H_ENABLE
+  &wt440hProtocol,
+#endif
+#ifdef MODULE_AURIOL_ENABLE
+  &auriolProtocol,
+#endif
+#ifdef MODULE_MEBUS_ENABLE
+  &mebusProtocol,
+#endif
+#ifdef MODULE_RFTECH_ENABLE
+  &rftechProtocol,
+#endif
+#if defined(MODULE_WS1700_ENABLE) && defined(MODULE_WS1700_VARIANT_WS1700)
+  &ws1700Protocol,
+#endif
+#if defined(MODULE_WS1700_ENABLE) && defined(MODULE_WS1700_VARIANT_GT_WT_01)
+  &gtwt01Protocol,
+#endif
+#ifdef MODULE_GT9000_ENABLE
+  &gt9000Protocol,
+#endif
+};
+
+// Number of compiled in protocols
+#define DECODER_PROTOCOL_COUNT (sizeof(protocols) / sizeof(protocols[0]))
+// Number of samples classified at once
+#define DECODER_CLASSIFY_BLOCK 256
+
+/***********************************************************************************************************************
+ * Allocate a zeroed context, there is no way to continue without it
+ **********************************************************************************************************************/
+static void *DecoderAllocate(size_t size)
+{
+  void *ctx = calloc(1, size ? size : 1);
+
+  if(ctx == NULL) {
+    perror("calloc()");
+    exit(EXIT_FAILURE);
+  }
+
+  return ctx;
+}
+
+/***********************************************************************************************************************
+ * Same decoder with byte identical timing parameters delivers the same bits
+ **********************************************************************************************************************/
+static bool DecoderSameBits(const BitDecoderType *bitDecoder1, const void *timing1, const BitDecoderType *bitDecoder2,
+  const void *timing2)
+{
+  return (bitDecoder1 == bitDecoder2) &&
+    ((bitDecoder1->timingSize == 0) || !memcmp(timing1, timing2, bitDecoder1->timingSize));
+}
+
+/***********************************************************************************************************************
+ * Find the bit stream decoding pulses the same way as the given protocol or create a new one
+ **********************************************************************************************************************/
+static DecoderStreamType *DecoderGetStream(DecoderContext *ctx, const ProtocolType *protocol,
+  TimingProfileType profile)
+{
+  const BitDecoderType *bitDecoder = protocol->bitDecoder;
+  const void *timing = protocol->timing[profile];
+  DecoderStreamType *stream;
+
+  for(size_t i = 0; i < ctx->streamCount; i++) {
+    stream = &ctx->streams[i];
+    if(DecoderSameBits(stream->bitDecoder, stream->timing, bitDecoder, timing)) {
+      return stream;
+    }
+  }
+
+  stream = &ctx->streams[ctx->streamCount++];
+  stream->bitDecoder = bitDecoder;
+  stream->timing = timing;
+  stream->ctx = DecoderAllocate(bitDecoder->contextSize);
+  stream->parserCount = 0;
+  stream->syncCount = 0;
+  bitDecoder->init(stream->ctx, timing);
+  FrameAssemblerInit(&stream->assembler);
+
+  return stream;
+}
+
+/***********************************************************************************************************************
+ * Select protocols from a comma separated list of protocol names or "all". Names prefixed with '+' or '-' are added
+ * to or removed from the actual selection, otherwise the list replaces it.
+ **********************************************************************************************************************/
+static bool DecoderSelectProtocols(DecoderConfigType *config, const char *list, bool strict)
+{
+  uint32_t selection = ((*list == '+') || (*list == '-')) ? config->protocols : 0;
+  bool retval = false;
+
+  while(*list != 0) {
+    size_t length = strcspn(list, ",");
+    bool remove = (*list == '-');
+    uint32_t mask = 0;
+
+    // Skip prefix
+    if((*list == '+') || (*list == '-')) {
+      list++;
+      length--;
+    }
+    // Look up name
+    if((length == 3) && !strncmp(list, "all", length)) {
+      mask = (1UL << DECODER_PROTOCOL_COUNT) - 1;
+    }
+    for(size_t i = 0; i < DECODER_PROTOCOL_COUNT; i++) {
+      if((strlen(protocols[i]->name) == length) && !strncmp(list, protocols[i]->name, length)) {
+        mask = 1UL << i;
+      }
+    }
+    if((mask == 0) && strict) {
+      fprintf(stderr, "Unknown protocol: %.*s\n", (int)length, list);
+      goto exit;
+    }
+    selection = remove ? (selection & ~mask) : (selection | mask);
+
+    // Next name
+    list += length;
+    if(*list == ',') {
+      list++;
+    }
+  }
+
+  config->protocols = selection;
+  retval = true;
+
+  exit:
+  return retval;
+}
+
+/***********************************************************************************************************************
+ * Select protocols from the command line or configuration file
+ **********************************************************************************************************************/
+bool DecoderConfigProtocols(DecoderConfigType *config, const char *list)
+{
+  return DecoderSelectProtocols(config, list, true);
+}
+
+/***********************************************************************************************************************
+ * Default configuration from config.h
+ **********************************************************************************************************************/
+void DecoderConfigDefault(DecoderConfigType *config)
+{
+  config->protocols = 0;
+  // Protocols not compiled in are silently left out
+  DecoderSelectProtocols(config, DEFAULT_PROTOCOLS, false);
+  for(size_t i = 0; i < DECODER_PROTOCOL_COUNT; i++) {
+    config->confirm[i] = protocols[i]->confirm;
+    config->thread[i] = DECODER_THREAD_AUTO;
+  }
+  config->threads = 1;
+#ifdef ANALOG_FILTER
+  config->timing = TimingAnalog;
+#else
+  config->timing = TimingDigital;
+#endif
+}
+
+/***********************************************************************************************************************
+ * Select timing profile by name
+ **********************************************************************************************************************/
+bool DecoderConfigTiming(DecoderConfigType *config, const char *name)
+{
+  bool retval = true;
+
+  if(!strcmp(name, "digital")) {
+    config->timing = TimingDigital;
+  }
+  else if(!strcmp(name, "analog")) {
+    config->timing = TimingAnalog;
+  }
+  else {
+    fprintf(stderr, "Unknown timing profile: %s\n", name);
+    retval = false;
+  }
+
+  return retval;
+}
+
+/***********************************************************************************************************************
+ * Apply a comma separated list of <protocol>=<value> entries, "all" addresses every protocol
+ **********************************************************************************************************************/
+static bool DecoderConfigEntries(DecoderConfigType *config, const char *list, const char *what,
+  bool (*apply)(DecoderConfigType *config, size_t protocol, const char *value))
+{
+  bool retval = false;
+
+  while(*list != 0) {
+    size_t length = strcspn(list, ",");
+    size_t nameLength = strcspn(list, "=,");
+    char value[16];
+    bool found = false;
+
+    if((nameLength >= length) || ((length - nameLength - 1) >= sizeof(value))) {
+      fprintf(stderr, "Invalid %s entry: %.*s\n", what, (int)length, list);
+      goto exit;
+    }
+    memcpy(value, list + nameLength + 1, length - nameLength - 1);
+    value[length - nameLength - 1] = 0;
+
+    // Look up name
+    for(size_t i = 0; i < DECODER_PROTOCOL_COUNT; i++) {
+      if(((nameLength == 3) && !strncmp(list, "all", nameLength)) ||
+         ((strlen(protocols[i]->name) == nameLength) && !strncmp(list, protocols[i]->name, nameLength))) {
+        if(!apply(config, i, value)) {
+          fprintf(stderr, "Invalid %s: %s\n", what, value);
+          goto exit;
+        }
+        found = true;
+      }
+    }
+    if(!found) {
+      fprintf(stderr, "Unknown protocol: %.*s\n", (int)nameLength, list);
+      goto exit;
+    }
+
+    // Next entry
+    list += length;
+    if(*list == ',') {
+      list++;
+    }
+  }
+  retval = true;
+
+  exit:
+  return retval;
+}
+
+/***********************************************************************************************************************
+ * Set the confirmation policy of a protocol
+ **********************************************************************************************************************/
+static bool DecoderApplyConfirm(DecoderConfigType *config, size_t protocol, const char *value)
+{
+  return DedupPolicyParse(&config->confirm[protocol], value);
+}
+
+/***********************************************************************************************************************
+ * Set confirmation policies from a comma separated list of <protocol>=<policy> entries
+ **********************************************************************************************************************/
+bool DecoderConfigConfirm(DecoderConfigType *config, const char *list)
+{
+  return DecoderConfigEntries(config, list, "confirmation policy", DecoderApplyConfirm);
+}
+
+/***********************************************************************************************************************
+ * Set the decoder thread of a protocol
+ **********************************************************************************************************************/
+static bool DecoderApplyThread(DecoderConfigType *config, size_t protocol, const char *value)
+{
+  char *end;
+  unsigned long thread = strtoul(value, &end, 10);
+
+  if((*value == 0) || (*end != 0) || (thread >= DECODER_MAX_THREADS)) {
+    return false;
+  }
+  config->thread[protocol] = thread;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Assign protocols to decoder threads from a comma separated list of <protocol>=<thread> entries, threads are counted
+ * from 0
+ **********************************************************************************************************************/
+bool DecoderConfigAssign(DecoderConfigType *config, const char *list)
+{
+  return DecoderConfigEntries(config, list, "decoder thread", DecoderApplyThread);
+}
+
+/***********************************************************************************************************************
+ * Set the number of decoder threads
+ **********************************************************************************************************************/
+bool DecoderConfigThreads(DecoderConfigType *config, const char *value)
+{
+  char *end;
+  unsigned long threads = strtoul(value, &end, 10);
+
+  if((*value == 0) || (*end != 0) || (threads < 1) || (threads > DECODER_MAX_THREADS)) {
+    fprintf(stderr, "Invalid number of decoder threads: %s (1 .. %u)\n", value, DECODER_MAX_THREADS);
+    return false;
+  }
+  config->threads = threads;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Check the configuration once all settings are applied
+ **********************************************************************************************************************/
+bool DecoderConfigCheck(const DecoderConfigType *config)
+{
+  for(size_t i = 0; i < DECODER_PROTOCOL_COUNT; i++) {
+    if((config->protocols & (1UL << i)) && (config->thread[i] != DECODER_THREAD_AUTO) &&
+       (config->thread[i] >= config->threads)) {
+      fprintf(stderr, "Protocol %s is assigned to decoder thread %u, but there are only %u\n", protocols[i]->name,
+        config->thread[i], config->threads);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Selected protocols decoded by a thread. Protocols not assigned explicitly are spread over the threads, but protocols
+ * sharing a bit stream stay together so their bits are decoded only once.
+ **********************************************************************************************************************/
+uint32_t DecoderThreadProtocols(const DecoderConfigType *config, unsigned thread)
+{
+  uint8_t assigned[DECODER_MAX_PROTOCOLS];
+  unsigned next = 0;
+  uint32_t mask = 0;
+
+  for(size_t i = 0; i < DECODER_PROTOCOL_COUNT; i++) {
+    if(!(config->protocols & (1UL << i))) {
+      continue;
+    }
+    assigned[i] = config->thread[i];
+    if(assigned[i] == DECODER_THREAD_AUTO) {
+      for(size_t j = 0; j < i; j++) {
+        if((config->protocols & (1UL << j)) && (config->thread[j] == DECODER_THREAD_AUTO) &&
+           DecoderSameBits(protocols[i]->bitDecoder, protocols[i]->timing[config->timing], protocols[j]->bitDecoder,
+             protocols[j]->timing[config->timing])) {
+          assigned[i] = assigned[j];
+          break;
+        }
+      }
+      if(assigned[i] == DECODER_THREAD_AUTO) {
+        assigned[i] = (next++) % config->threads;
+      }
+    }
+    if(assigned[i] == thread) {
+      mask |= 1UL << i;
+    }
+  }
+
+  return mask;
+}
+
+/***********************************************************************************************************************
+ * Print the compiled in protocols with their confirmation policy, marking the selected ones
+ **********************************************************************************************************************/
+void DecoderPrintProtocols(const DecoderConfigType *config, FILE *stream)
+{
+  for(size_t i = 0; i < DECODER_PROTOCOL_COUNT; i++) {
+    fprintf(stream, "%c %-8s %u-of-%u", (config->protocols & (1UL << i)) ? '*' : ' ', protocols[i]->name,
+      config->confirm[i].count, config->confirm[i].window);
+    // Decoder thread of the selected protocols
+    for(unsigned thread = 0; (config->threads > 1) && (thread < config->threads); thread++) {
+      if(DecoderThreadProtocols(config, thread) & (1UL << i)) {
+        fprintf(stream, " thread %u", thread);
+      }
+    }
+    fprintf(stream, "\n");
+  }
+}
+
+/***********************************************************************************************************************
+ * Initialize the selected decoders of a decoder context. Messages are passed to the output target, or to the output
+ * stage if there is none.
+ **********************************************************************************************************************/
+void DecoderInit(DecoderContext *ctx, const char *tag, TimeStampSourceType timeSource, const DecoderConfigType *config,
+  const OutputTargetType *output)
+{
+  TimeStampInit(&ctx->clock, timeSource);
+  DedupInit(&ctx->dedup);
+  ctx->environment.tag = tag;
+  ctx->environment.dedup = &ctx->dedup;
+  ctx->environment.output.queue = (output != NULL) ? output->queue : NULL;
+  ctx->environment.output.list = (output != NULL) ? output->list : NULL;
+  ctx->streamCount = 0;
+
+  for(size_t i = 0; i < DECODER_PROTOCOL_COUNT; i++) {
+    // Protocols not selected do not even get a context
+    if(!(config->protocols & (1UL << i))) {
+      continue;
+    }
+    DecoderStreamType *stream = DecoderGetStream(ctx, protocols[i], config->timing);
+    DecoderParserType *parser = &stream->parsers[stream->parserCount++];
+
+    parser->protocol = protocols[i];
+    parser->ctx = DecoderAllocate(protocols[i]->contextSize);
+    parser->count = 0;
+    parser->pending.length = 0;
+    protocols[i]->init(parser->ctx, &ctx->environment, config->confirm[i]);
+
+    // Frames with a sync word are searched at every bit
+    if(protocols[i]->syncLength > 0) {
+      DecoderSyncType *sync = &stream->syncs[stream->syncCount++];
+      uint8_t shift = protocols[i]->frameLength - protocols[i]->syncLength;
+
+      sync->parser = parser;
+      sync->frameLength = protocols[i]->frameLength;
+      sync->mask = (((uint64_t)1 << protocols[i]->syncLength) - 1) << shift;
+      sync->sync = (uint64_t)protocols[i]->sync << shift;
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Cut the frames of every protocol of a stream after a new bit. A stream holds one frame or repeats sent back to back
+ * without a break, so it is cut into frames of frameLength bits. A frame is parsed as soon as the next one is complete
+ * or the stream ends behind it (see DecoderEndStream), so the head of a longer frame of another protocol (e.g. the
+ * first 24 bits of an Auriol frame for RF-Tech) is not parsed on its own. The frames of a stream holding more than one
+ * frame may as well be noise, like the ones found behind other bits they must be confirmed by a repeat (see
+ * CONFIRM_OFFSET), which back to back repeats provide. Protocols sharing a bit stream cannot always
+ * be told apart (e.g. a WS1700 frame may pass the Auriol checksum), so no protocol claims a frame: dropping a genuine
+ * message is worse than decoding it twice.
+ **********************************************************************************************************************/
+static void DecoderCutFrames(DecoderStreamType *stream)
+{
+  for(size_t p = 0; p < stream->parserCount; p++) {
+    DecoderParserType *parser = &stream->parsers[p];
+
+    if(++parser->count == parser->protocol->frameLength) {
+      bool more = (parser->pending.length > 0);
+
+      if(more) {
+        parser->pending.offset = true;
+        parser->protocol->parse(parser->ctx, &parser->pending);
+      }
+      FrameAssemblerLast(&stream->assembler, parser->count, &parser->pending);
+      parser->pending.offset = more;
+      parser->count = 0;
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Parse the last frame cut from a stream that ended, if at most frameLengthMax - frameLength trailing bits follow it
+ **********************************************************************************************************************/
+static void DecoderEndStream(DecoderStreamType *stream)
+{
+  for(size_t p = 0; p < stream->parserCount; p++) {
+    DecoderParserType *parser = &stream->parsers[p];
+    const ProtocolType *protocol = parser->protocol;
+
+    if((parser->pending.length > 0) && (parser->count <= (protocol->frameLengthMax - protocol->frameLength))) {
+      protocol->parse(parser->ctx, &parser->pending);
+    }
+    parser->pending.length = 0;
+    parser->count = 0;
+  }
+}
+
+/***********************************************************************************************************************
+ * Look for sync words after a new bit of the stream. The bits before a frame may be noise or the rest of a broken
+ * frame, so a frame is found at any offset in the stream and validated by its protocol (checksum, field values). This
+ * costs a mask and a compare per protocol and bit. Frames the stream is cut into are left to DecoderCutFrames, the ones
+ * behind other bits must be confirmed by a repeat (see CONFIRM_OFFSET).
+ **********************************************************************************************************************/
+static void DecoderCorrelate(DecoderStreamType *stream)
+{
+  const FrameType *history = &stream->assembler.frame;
+
+  for(size_t c = 0; c < stream->syncCount; c++) {
+    const DecoderSyncType *sync = &stream->syncs[c];
+
+    if((history->length > sync->frameLength) && (sync->parser->count != 0) &&
+       ((history->bits & sync->mask) == sync->sync)) {
+      FrameType frame;
+
+      FrameAssemblerLast(&stream->assembler, sync->frameLength, &frame);
+      sync->parser->protocol->parse(sync->parser->ctx, &frame);
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Decode a batch of lirc samples
+ **********************************************************************************************************************/
+void DecoderProcess(DecoderContext *ctx, const uint32_t *samples, size_t count)
+{
+  PulseClassType classes[DECODER_CLASSIFY_BLOCK];
+
+  for(size_t i = 0; i < count; i++) {
+    uint32_t mode = samples[i] & LIRC_MODE2_MASK;
+    PulseType pulse;
+
+    // Classify the next block of samples at once for all decoders
+    if((i % DECODER_CLASSIFY_BLOCK) == 0) {
+      PulseClassifyBatch(samples + i, ((count - i) < DECODER_CLASSIFY_BLOCK) ? (count - i) : DECODER_CLASSIFY_BLOCK,
+        classes);
+    }
+
+    // Carrier frequency reports are no durations
+    if(mode == LIRC_MODE2_FREQUENCY) {
+      continue;
+    }
+    pulse.kind = (mode == LIRC_MODE2_PULSE) ? PULSE_MARK : (mode == LIRC_MODE2_TIMEOUT) ? PULSE_TIMEOUT : PULSE_SPACE;
+    pulse.length = samples[i] & LIRC_VALUE_MASK;
+    pulse.classes = classes[i % DECODER_CLASSIFY_BLOCK];
+
+    // Advance pulse time
+    TimeStampAdvance(&ctx->clock, pulse.length);
+
+    // Decode the pulse once per bit stream and hand valid bits to every protocol on it
+    for(size_t s = 0; s < ctx->streamCount; s++) {
+      DecoderStreamType *stream = &ctx->streams[s];
+      BitType bit = stream->bitDecoder->decode(stream->ctx, &pulse);
+
+      // Assemble frames only once for all protocols
+      if(FrameAssemblerAdd(&stream->assembler, bit, TimeStampGet(&ctx->clock))) {
+        DecoderEndStream(stream);
+      }
+      if(bit & BIT_VALID) {
+        DecoderCutFrames(stream);
+        DecoderCorrelate(stream);
+      }
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Get the duration of a batch of lirc samples in us, the time DecoderProcess advances the pulse clock by
+ **********************************************************************************************************************/
+uint64_t DecoderDuration(const uint32_t *samples, size_t count)
+{
+  uint64_t duration = 0;
+
+  for(size_t i = 0; i < count; i++) {
+    if((samples[i] & LIRC_MODE2_MASK) != LIRC_MODE2_FREQUENCY) {
+      duration += samples[i] & LIRC_VALUE_MASK;
+    }
+  }
+
+  return duration;
+}
+
+/***********************************************************************************************************************
+ * Release all decoders of a decoder context
+ **********************************************************************************************************************/
+void DecoderFree(DecoderContext *ctx)
+{
+  for(size_t s = 0; s < ctx->streamCount; s++) {
+    for(size_t p = 0; p < ctx->streams[s].parserCount; p++) {
+      free(ctx->streams[s].parsers[p].ctx);
+    }
+    free(ctx->streams[s].ctx);
+  }
+  ctx->streamCount = 0;
+}
@@ -0,0 +1,134 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef DECODER_H_
+#define DECODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "TimeStamp.h"
+#include "Protocol.h"
+#include "FrameAssembler.h"
+
+// Maximum number of protocols in one decoder context
+#define DECODER_MAX_PROTOCOLS 16
+// Maximum number of decoder threads
+#define DECODER_MAX_THREADS   8
+// Protocol assigned to a decoder thread automatically
+#define DECODER_THREAD_AUTO   0xFF
+
+// Protocol fed by a bit stream
+typedef struct {
+  // Protocol description
+  const ProtocolType *protocol;
+  // Protocol context
+  void *ctx;
+  // Bits of the actual stream behind the last frame cut from it
+  uint8_t count;
+  // Last frame cut from the actual stream, not parsed yet (length 0 if none)
+  FrameType pending;
+} DecoderParserType;
+
+// Sync word search of a protocol: the last frameLength bits of a stream are a frame candidate if the sync word is at
+// their beginning
+typedef struct {
+  // Parser of the candidates
+  DecoderParserType *parser;
+  uint8_t frameLength;
+  // Sync word in the last frameLength bits
+  uint64_t mask;
+  uint64_t sync;
+} DecoderSyncType;
+
+// Bit stream: one bit decoder shared by all protocols with the same bit decoder and timing
+typedef struct {
+  // Bit decoder description and its timing parameters
+  const BitDecoderType *bitDecoder;
+  const void *timing;
+  // Bit decoder context
+  void *ctx;
+  // Assembler of the frames
+  FrameAssemblerContext assembler;
+  // Protocols fed with the frames
+  DecoderParserType parsers[DECODER_MAX_PROTOCOLS];
+  size_t parserCount;
+  // Protocols searching their sync word after every bit
+  DecoderSyncType syncs[DECODER_MAX_PROTOCOLS];
+  size_t syncCount;
+} DecoderStreamType;
+
+// Decoder context: a complete, independent set of protocol decoders for one pulse stream
+typedef struct {
+  // Time stamp clock of the stream
+  TimeStampContext clock;
+  // Duplicate filter of all sensors heard on the stream
+  DedupTable dedup;
+  // Environment of the protocols
+  ProtocolEnvironmentType environment;
+  // Bit streams
+  DecoderStreamType streams[DECODER_MAX_PROTOCOLS];
+  size_t streamCount;
+} DecoderContext;
+
+// Decoder configuration
+typedef struct {
+  // Selected protocols, bit n selects the n-th compiled in protocol
+  uint32_t protocols;
+  // Timing profile
+  TimingProfileType timing;
+  // Confirmation policy per compiled in protocol
+  DedupPolicyType confirm[DECODER_MAX_PROTOCOLS];
+  // Number of decoder threads and the thread of each compiled in protocol
+  uint8_t threads;
+  uint8_t thread[DECODER_MAX_PROTOCOLS];
+} DecoderConfigType;
+
+void DecoderConfigDefault(DecoderConfigType *config);
+bool DecoderConfigProtocols(DecoderConfigType *config, const char *list);
+bool DecoderConfigTiming(DecoderConfigType *config, const char *name);
+bool DecoderConfigConfirm(DecoderConfigType *config, const char *list);
+bool DecoderConfigThreads(DecoderConfigType *config, const char *value);
+bool DecoderConfigAssign(DecoderConfigType *config, const char *list);
+bool DecoderConfigCheck(const DecoderConfigType *config);
+uint32_t DecoderThreadProtocols(const DecoderConfigType *config, unsigned thread);
+void DecoderPrintProtocols(const DecoderConfigType *config, FILE *stream);
+
+void DecoderInit(DecoderContext *ctx, const char *tag, TimeStampSourceType timeSource, const DecoderConfigType *config,
+  const OutputTargetType *output);
+void DecoderProcess(DecoderContext *ctx, const uint32_t *samples, size_t count);
+uint64_t DecoderDuration(const uint32_t *samples, size_t count);
+void DecoderFree(DecoderContext *ctx);
+
+#endif // DECODER_H_
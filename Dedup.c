@@ -0,0 +1,267 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "Dedup.h"
+
+// End of the LRU list
+#define LRU_NONE                  UINT16_MAX
+// Slot index mask
+#define SLOT_MASK                 (DEDUP_TABLE_SIZE - 1)
+
+/***********************************************************************************************************************
+ * Start with an empty table
+ **********************************************************************************************************************/
+void DedupInit(DedupTable *table)
+{
+  memset(table, 0, sizeof(DedupTable));
+  table->lruHead = LRU_NONE;
+  table->lruTail = LRU_NONE;
+}
+
+/***********************************************************************************************************************
+ * Hash protocol and sensor key
+ **********************************************************************************************************************/
+static uint32_t DedupHash(const void *protocol, uint64_t key)
+{
+  uint64_t hash = (key ^ (uintptr_t)protocol) * 0x9E3779B97F4A7C15ULL;
+
+  return hash >> 32;
+}
+
+/***********************************************************************************************************************
+ * Remove an entry from the LRU list
+ **********************************************************************************************************************/
+static void DedupLruUnlink(DedupTable *table, uint16_t slot)
+{
+  DedupEntry *entry = &table->entries[slot];
+
+  if(entry->lruPrev != LRU_NONE) {
+    table->entries[entry->lruPrev].lruNext = entry->lruNext;
+  }
+  else {
+    table->lruHead = entry->lruNext;
+  }
+  if(entry->lruNext != LRU_NONE) {
+    table->entries[entry->lruNext].lruPrev = entry->lruPrev;
+  }
+  else {
+    table->lruTail = entry->lruPrev;
+  }
+}
+
+/***********************************************************************************************************************
+ * Put an entry to the front of the LRU list
+ **********************************************************************************************************************/
+static void DedupLruPush(DedupTable *table, uint16_t slot)
+{
+  DedupEntry *entry = &table->entries[slot];
+
+  entry->lruPrev = LRU_NONE;
+  entry->lruNext = table->lruHead;
+  if(table->lruHead != LRU_NONE) {
+    table->entries[table->lruHead].lruPrev = slot;
+  }
+  else {
+    table->lruTail = slot;
+  }
+  table->lruHead = slot;
+}
+
+/***********************************************************************************************************************
+ * Remove an entry. Following entries of the probe sequence are shifted back, so lookups never need tombstones.
+ **********************************************************************************************************************/
+static void DedupRemove(DedupTable *table, uint16_t slot)
+{
+  uint16_t next = slot;
+
+  DedupLruUnlink(table, slot);
+  table->count--;
+
+  for(;;) {
+    next = (next + 1) & SLOT_MASK;
+    DedupEntry *entry = &table->entries[next];
+    if(!entry->used) {
+      break;
+    }
+    // Distances from the home slot of the entry; it may only move back if the hole lies on its probe sequence
+    uint16_t home = entry->hash & SLOT_MASK;
+    if(((slot - home) & SLOT_MASK) < ((next - home) & SLOT_MASK)) {
+      table->entries[slot] = *entry;
+      // Fix the LRU links pointing to the moved entry
+      if(entry->lruPrev != LRU_NONE) {
+        table->entries[entry->lruPrev].lruNext = slot;
+      }
+      else {
+        table->lruHead = slot;
+      }
+      if(entry->lruNext != LRU_NONE) {
+        table->entries[entry->lruNext].lruPrev = slot;
+      }
+      else {
+        table->lruTail = slot;
+      }
+      slot = next;
+    }
+  }
+
+  table->entries[slot].used = false;
+}
+
+/***********************************************************************************************************************
+ * Remember the message of a sensor. Returns true if it shall be output: the confirmation policy is fulfilled and the
+ * message was not output yet.
+ **********************************************************************************************************************/
+bool DedupCheck(DedupTable *table, const void *protocol, uint64_t key, uint64_t message, uint64_t timeStamp,
+  DedupPolicyType policy)
+{
+  uint32_t hash = DedupHash(protocol, key);
+  uint16_t slot = hash & SLOT_MASK;
+  DedupEntry *entry;
+  uint8_t count = 0;
+  bool output = false;
+
+  // Look up sensor
+  while(table->entries[slot].used) {
+    entry = &table->entries[slot];
+    if((entry->hash == hash) && (entry->protocol == protocol) && (entry->key == key)) {
+      break;
+    }
+    slot = (slot + 1) & SLOT_MASK;
+  }
+  entry = &table->entries[slot];
+
+  // New sensor
+  if(!entry->used) {
+    // Make room by forgetting the sensor heard the longest time ago
+    if(table->count >= DEDUP_ENTRIES_MAX) {
+      DedupRemove(table, table->lruTail);
+      // The removal may have shifted entries, search the free slot again
+      slot = hash & SLOT_MASK;
+      while(table->entries[slot].used) {
+        slot = (slot + 1) & SLOT_MASK;
+      }
+      entry = &table->entries[slot];
+    }
+    entry->used = true;
+    entry->protocol = protocol;
+    entry->key = key;
+    entry->hash = hash;
+    entry->historyLength = 0;
+    entry->lock = false;
+    table->count++;
+  }
+  else {
+    DedupLruUnlink(table, slot);
+  }
+  DedupLruPush(table, slot);
+
+  // Add message to the history
+  memmove(&entry->messages[1], &entry->messages[0], sizeof(entry->messages[0]) * (DEDUP_HISTORY - 1));
+  memmove(&entry->timeStamps[1], &entry->timeStamps[0], sizeof(entry->timeStamps[0]) * (DEDUP_HISTORY - 1));
+  entry->messages[0] = message;
+  entry->timeStamps[0] = timeStamp;
+  if(entry->historyLength < DEDUP_HISTORY) {
+    entry->historyLength++;
+  }
+
+  // Repeats of the output message stay suppressed as long as they keep coming within the duplicate timeframe
+  if(entry->lock && (entry->lockMessage == message) && ((timeStamp - entry->lockTimeStamp) < DEDUP_DUPLICATE_TIME)) {
+    entry->lockTimeStamp = timeStamp;
+    goto exit;
+  }
+
+  // Count identical messages in the confirmation window, they can only be equal within the duplicate timeframe
+  for(uint8_t i = 0; (i < policy.window) && (i < entry->historyLength); i++) {
+    if((entry->messages[i] == message) && ((timeStamp - entry->timeStamps[i]) < DEDUP_DUPLICATE_TIME)) {
+      count++;
+    }
+  }
+  if(count >= policy.count) {
+    entry->lock = true;
+    entry->lockMessage = message;
+    entry->lockTimeStamp = timeStamp;
+    output = true;
+  }
+
+  exit:
+  return output;
+}
+
+/***********************************************************************************************************************
+ * Parse a confirmation policy: "first", "<n>-of-<m>" or "majority-of-<m>"
+ **********************************************************************************************************************/
+bool DedupPolicyParse(DedupPolicyType *policy, const char *string)
+{
+  unsigned count, window;
+  int length = -1;
+  bool retval = false;
+
+  if(!strcmp(string, "first")) {
+    count = window = 1;
+  }
+  else if((sscanf(string, "majority-of-%u%n", &window, &length) == 1) && (string[length] == 0)) {
+    count = (window / 2) + 1;
+  }
+  else if((sscanf(string, "%u-of-%u%n", &count, &window, &length) == 2) && (string[length] == 0)) {
+    // Count and window given
+  }
+  else {
+    goto exit;
+  }
+
+  if((count >= 1) && (count <= window) && (window <= DEDUP_HISTORY)) {
+    policy->count = count;
+    policy->window = window;
+    retval = true;
+  }
+
+  exit:
+  return retval;
+}
+
+/***********************************************************************************************************************
+ * Raise a confirmation policy to at least the given number of identical messages
+ **********************************************************************************************************************/
+DedupPolicyType DedupPolicyAtLeast(DedupPolicyType policy, DedupPolicyType minimum)
+{
+  if(policy.count < minimum.count) {
+    policy.count = minimum.count;
+  }
+  if(policy.window < policy.count) {
+    policy.window = policy.count;
+  }
+
+  return policy;
+}
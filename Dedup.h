@@ -0,0 +1,106 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef DEDUP_H_
+#define DEDUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Number of slots of the table (power of two)
+#define DEDUP_TABLE_SIZE          256
+// Sensors remembered at most, the least recently heard one is evicted beyond
+#define DEDUP_ENTRIES_MAX         ((DEDUP_TABLE_SIZE * 3) / 4)
+// Search for identical messages within this timeframe in uS
+#define DEDUP_DUPLICATE_TIME      1000000
+// Longest confirmation window in messages
+#define DEDUP_HISTORY             4
+
+// Confirmation policy: a message is output once it was received count times among the last window messages of the
+// sensor (within the duplicate timeframe). Later repeats of an output message are suppressed.
+typedef struct {
+  uint8_t count;
+  uint8_t window;
+} DedupPolicyType;
+
+// Output the first valid message, for protocols with a checksum
+#define CONFIRM_FIRST             { 1, 1 }
+// Output a message received n times among the last m ones
+#define CONFIRM_REPEAT(n, m)      { (n), (m) }
+// Output a message received in the majority of the last m ones
+#define CONFIRM_MAJORITY(m)       { ((m) / 2) + 1, (m) }
+// Least confirmation of frames found behind other bits of a stream. A sync word search at every bit offers plenty of
+// noise to the checksums, none of them is strong enough to let such a frame through alone.
+#define CONFIRM_OFFSET            CONFIRM_REPEAT(2, 2)
+
+// Last messages of one sensor
+typedef struct {
+  // Protocol and sensor key
+  const void *protocol;
+  uint64_t key;
+  // Last messages and their reception time stamps, newest first
+  uint64_t messages[DEDUP_HISTORY];
+  uint64_t timeStamps[DEDUP_HISTORY];
+  // Last output message and the time it was last received
+  uint64_t lockMessage;
+  uint64_t lockTimeStamp;
+  // Hash of protocol and key
+  uint32_t hash;
+  // Neighbours in the LRU list
+  uint16_t lruPrev;
+  uint16_t lruNext;
+  // Number of valid history entries
+  uint8_t historyLength;
+  // Slot in use
+  bool used;
+  // Output message is locked
+  bool lock;
+} DedupEntry;
+
+// Duplicate filter table: open addressing with linear probing, entries chained in LRU order
+typedef struct {
+  DedupEntry entries[DEDUP_TABLE_SIZE];
+  // Number of used entries
+  uint16_t count;
+  // Most and least recently used entries
+  uint16_t lruHead;
+  uint16_t lruTail;
+} DedupTable;
+
+void DedupInit(DedupTable *table);
+bool DedupCheck(DedupTable *table, const void *protocol, uint64_t key, uint64_t message, uint64_t timeStamp,
+  DedupPolicyType policy);
+bool DedupPolicyParse(DedupPolicyType *policy, const char *string);
+DedupPolicyType DedupPolicyAtLeast(DedupPolicyType policy, DedupPolicyType minimum);
+
+#endif // DEDUP_H_
@@ -0,0 +1,361 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "TimeStamp.h"
+#include "Protocol.h"
+#include "Fhem.h"
+
+// FHEM device of a protocol, it is named after the protocol, the id and the channel
+typedef struct {
+  // Protocol name
+  const char *protocol;
+  // Humidity readings up to this value are no measurement and reported as 0 (-1 if all are valid)
+  int humidityInvalid;
+  // The temperature is reported without its sign, as printed in the text message weather2fhem.sh read
+  bool temperatureMagnitude;
+} FhemDeviceType;
+
+// Devices of the protocols
+static const FhemDeviceType fhemDevices[] = {
+  { "wt440h", 14, false },
+  { "auriol", 20, false },
+  { "mebus",  -1, false },
+  { "ws1700", -1, false },
+  { "rftech", -1, true }
+};
+
+/***********************************************************************************************************************
+ * Close the connection and schedule the next attempt
+ **********************************************************************************************************************/
+static void FhemDisconnect(FhemContext *ctx)
+{
+  if(ctx->fd >= 0) {
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+  ctx->connecting = false;
+  ctx->nextAttempt = TimeStampMonotonic() + ctx->backoff * 1000ULL;
+  ctx->backoff = (ctx->backoff * 2 > FHEM_BACKOFF_MAX) ? FHEM_BACKOFF_MAX : ctx->backoff * 2;
+}
+
+/***********************************************************************************************************************
+ * Start connecting without blocking
+ **********************************************************************************************************************/
+static void FhemConnect(FhemContext *ctx)
+{
+  struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+  struct addrinfo *addresses = NULL;
+
+  if(getaddrinfo(ctx->host, ctx->port, &hints, &addresses) != 0) {
+    goto exit;
+  }
+  ctx->fd = socket(addresses->ai_family, addresses->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+    addresses->ai_protocol);
+  if(ctx->fd < 0) {
+    goto exit;
+  }
+  if(connect(ctx->fd, addresses->ai_addr, addresses->ai_addrlen) == 0) {
+    ctx->connects++;
+    ctx->backoff = FHEM_BACKOFF_MIN;
+  }
+  else if(errno == EINPROGRESS) {
+    ctx->connecting = true;
+  }
+  else {
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+
+  exit:
+  if(addresses != NULL) {
+    freeaddrinfo(addresses);
+  }
+  if(ctx->fd < 0) {
+    FhemDisconnect(ctx);
+  }
+}
+
+/***********************************************************************************************************************
+ * Parse the address (host[:port]) and start with no connection, it is established with the first flush
+ **********************************************************************************************************************/
+bool FhemInit(FhemContext *ctx, const char *address)
+{
+  const char *separator = strrchr(address, ':');
+  size_t hostLength = separator ? (size_t)(separator - address) : strlen(address);
+  const char *port = separator ? (separator + 1) : FHEM_DEFAULT_PORT;
+
+  if((hostLength == 0) || (hostLength >= sizeof(ctx->host)) || (*port == 0) || (strlen(port) >= sizeof(ctx->port))) {
+    fprintf(stderr, "Invalid FHEM address: %s\n", address);
+    return false;
+  }
+  memcpy(ctx->host, address, hostLength);
+  ctx->host[hostLength] = 0;
+  strcpy(ctx->port, port);
+
+  ctx->fd = -1;
+  ctx->connecting = false;
+  ctx->nextAttempt = 0;
+  ctx->backoff = FHEM_BACKOFF_MIN;
+  ctx->length = 0;
+  ctx->messages = 0;
+  ctx->writes = 0;
+  ctx->dropped = 0;
+  ctx->connects = 0;
+  pthread_mutex_init(&ctx->lock, NULL);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Turn a reading into FHEM commands, the same way as the former weather2fhem.sh script did. Readings of protocols
+ * without a device or without a temperature are ignored.
+ **********************************************************************************************************************/
+void FhemRecord(FhemContext *ctx, const OutputRecordType *record)
+{
+  const FhemDeviceType *device = NULL;
+  char name[128];
+  char temperature[16];
+  char humidity[16];
+  char commands[2048];
+  bool hasHumidity = OutputHas(record, QuantityHumidity);
+  bool batteryLow = (record->battery == BatteryLow);
+  int length;
+
+  for(size_t d = 0; d < (sizeof(fhemDevices) / sizeof(fhemDevices[0])); d++) {
+    if(!strcmp(record->protocol->name, fhemDevices[d].protocol)) {
+      device = &fhemDevices[d];
+      break;
+    }
+  }
+  if((device == NULL) || !OutputHas(record, QuantityTemperature)) {
+    return;
+  }
+
+  // Device name: protocol, id and channel joined by '_'
+  if(record->channel >= 0) {
+    snprintf(name, sizeof(name), "%s_%d_%d", device->protocol, record->id, record->channel);
+  }
+  else {
+    snprintf(name, sizeof(name), "%s_%d", device->protocol, record->id);
+  }
+
+  // Same text as the printed message: one decimal
+  OutputTenths(temperature, sizeof(temperature), device->temperatureMagnitude ?
+    abs(record->values[QuantityTemperature]) : record->values[QuantityTemperature]);
+  if(hasHumidity) {
+    snprintf(humidity, sizeof(humidity), "%d",
+      (record->values[QuantityHumidity] <= device->humidityInvalid) ? 0 : record->values[QuantityHumidity]);
+  }
+
+  length = snprintf(commands, sizeof(commands), "setreading %s temperature %s\n", name, temperature);
+  if(hasHumidity) {
+    length += snprintf(commands + length, sizeof(commands) - length, "setreading %s humidity %s\n", name, humidity);
+  }
+  length += snprintf(commands + length, sizeof(commands) - length,
+    "setreading %s battery %s\nsetreading %s warnings %s\n",
+    name, batteryLow ? "low" : "ok", name, batteryLow ? "battery" : "none");
+  // State: "21.5°C, 45%, Bat.low!"
+  length += snprintf(commands + length, sizeof(commands) - length, "set %s %s\xC2\xB0" "C%s%s%s%s\n",
+    name, temperature, hasHumidity ? ", " : "", hasHumidity ? humidity : "", hasHumidity ? "%" : "",
+    batteryLow ? ", Bat.low!" : "");
+
+  ctx->messages++;
+  // Keep whole messages only
+  if((length >= (int)sizeof(commands)) || ((ctx->length + length) > sizeof(ctx->buffer))) {
+    ctx->dropped++;
+    return;
+  }
+  memcpy(ctx->buffer + ctx->length, commands, length);
+  ctx->length += length;
+}
+
+/***********************************************************************************************************************
+ * Send the queued commands with as few writes as possible, never blocks. (Re)connects if needed.
+ **********************************************************************************************************************/
+void FhemFlush(FhemContext *ctx)
+{
+  struct pollfd pfd;
+  char discard[256];
+
+  // Nothing to send
+  if((ctx->length == 0) && (ctx->fd < 0)) {
+    return;
+  }
+
+  // Connect when the backoff delay is over
+  if(ctx->fd < 0) {
+    if(TimeStampMonotonic() < ctx->nextAttempt) {
+      return;
+    }
+    FhemConnect(ctx);
+    if(ctx->fd < 0) {
+      return;
+    }
+  }
+
+  // Wait for the connection to be established
+  if(ctx->connecting) {
+    int error = 0;
+    socklen_t size = sizeof(error);
+
+    pfd = (struct pollfd) { .fd = ctx->fd, .events = POLLOUT };
+    if(poll(&pfd, 1, 0) <= 0) {
+      return;
+    }
+    if((getsockopt(ctx->fd, SOL_SOCKET, SO_ERROR, &error, &size) < 0) || (error != 0)) {
+      FhemDisconnect(ctx);
+      return;
+    }
+    ctx->connecting = false;
+    ctx->connects++;
+    ctx->backoff = FHEM_BACKOFF_MIN;
+  }
+
+  // Throw away the answers, notice a closed connection
+  for(;;) {
+    ssize_t received = recv(ctx->fd, discard, sizeof(discard), MSG_DONTWAIT);
+    if(received > 0) {
+      continue;
+    }
+    if((received == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))) {
+      FhemDisconnect(ctx);
+      return;
+    }
+    break;
+  }
+
+  // Send as much as the socket takes
+  while(ctx->length > 0) {
+    ssize_t sent = send(ctx->fd, ctx->buffer, ctx->length, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if(sent < 0) {
+      if((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+        FhemDisconnect(ctx);
+      }
+      return;
+    }
+    ctx->writes++;
+    ctx->length -= sent;
+    memmove(ctx->buffer, ctx->buffer + sent, ctx->length);
+  }
+}
+
+/***********************************************************************************************************************
+ * Send the remaining commands for a while and close the connection
+ **********************************************************************************************************************/
+void FhemClose(FhemContext *ctx)
+{
+  uint64_t end = TimeStampMonotonic() + FHEM_CLOSE_TIMEOUT * 1000ULL;
+
+  // The first connection attempt is not delayed
+  if(ctx->fd < 0) {
+    ctx->nextAttempt = 0;
+  }
+  while((ctx->length > 0) && (TimeStampMonotonic() < end)) {
+    FhemFlush(ctx);
+    if(ctx->length > 0) {
+      if(ctx->fd >= 0) {
+        struct pollfd pfd = { .fd = ctx->fd, .events = POLLOUT };
+        poll(&pfd, 1, 50);
+      }
+      else {
+        usleep(50000);
+      }
+    }
+  }
+  if(ctx->fd >= 0) {
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+}
+
+/***********************************************************************************************************************
+ * Print statistics
+ **********************************************************************************************************************/
+void FhemPrintStatistics(FhemContext *ctx, FILE *stream)
+{
+  pthread_mutex_lock(&ctx->lock);
+  fprintf(stream, "fhem %s:%s: %s, %llu messages, %llu writes, %llu dropped, %llu connects, %zu bytes pending\n",
+    ctx->host, ctx->port, ((ctx->fd >= 0) && !ctx->connecting) ? "connected" : "not connected",
+    (unsigned long long)ctx->messages, (unsigned long long)ctx->writes, (unsigned long long)ctx->dropped,
+    (unsigned long long)ctx->connects, ctx->length);
+  pthread_mutex_unlock(&ctx->lock);
+}
+
+/***********************************************************************************************************************
+ * Sink callbacks, they run in the sink thread. The lock keeps the statistics consistent.
+ **********************************************************************************************************************/
+static void FhemSinkWrite(void *ctx, const OutputRecordType *record)
+{
+  FhemContext *fhem = ctx;
+
+  pthread_mutex_lock(&fhem->lock);
+  FhemRecord(fhem, record);
+  pthread_mutex_unlock(&fhem->lock);
+}
+
+static void FhemSinkFlush(void *ctx)
+{
+  FhemContext *fhem = ctx;
+
+  pthread_mutex_lock(&fhem->lock);
+  FhemFlush(fhem);
+  pthread_mutex_unlock(&fhem->lock);
+}
+
+static void FhemSinkClose(void *ctx)
+{
+  FhemContext *fhem = ctx;
+
+  pthread_mutex_lock(&fhem->lock);
+  FhemClose(fhem);
+  pthread_mutex_unlock(&fhem->lock);
+}
+
+/***********************************************************************************************************************
+ * Output sink feeding the connection
+ **********************************************************************************************************************/
+OutputSinkType FhemSink(FhemContext *ctx)
+{
+  return (OutputSinkType) {
+    .name = "fhem", .write = FhemSinkWrite, .flush = FhemSinkFlush, .close = FhemSinkClose, .ctx = ctx
+  };
+}
@@ -0,0 +1,84 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef FHEM_H_
+#define FHEM_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "Output.h"
+
+// Default telnet port of FHEM
+#define FHEM_DEFAULT_PORT         "7072"
+// Commands waiting to be sent, they are dropped while the buffer is full
+#define FHEM_BUFFER_SIZE          65536
+// Reconnect delays in ms, doubled after every failed attempt
+#define FHEM_BACKOFF_MIN          1000
+#define FHEM_BACKOFF_MAX          60000
+// Time given to send the remaining commands on close in ms
+#define FHEM_CLOSE_TIMEOUT        1000
+
+// FHEM connection
+typedef struct {
+  // Server address
+  char host[128];
+  char port[16];
+  // Socket, -1 if not connected
+  int fd;
+  // Connection establishment in progress
+  bool connecting;
+  // Next connection attempt (monotonic time in us) and the delay after a failure in ms
+  uint64_t nextAttempt;
+  uint32_t backoff;
+  // Commands not yet sent
+  char buffer[FHEM_BUFFER_SIZE];
+  size_t length;
+  // Statistics
+  uint64_t messages;
+  uint64_t writes;
+  uint64_t dropped;
+  uint64_t connects;
+  // Protects the connection against the statistics printed by another thread
+  pthread_mutex_t lock;
+} FhemContext;
+
+bool FhemInit(FhemContext *ctx, const char *address);
+void FhemRecord(FhemContext *ctx, const OutputRecordType *record);
+void FhemFlush(FhemContext *ctx);
+void FhemClose(FhemContext *ctx);
+void FhemPrintStatistics(FhemContext *ctx, FILE *stream);
+OutputSinkType FhemSink(FhemContext *ctx);
+
+#endif // FHEM_H_
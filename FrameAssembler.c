@@ -0,0 +1,77 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "FrameAssembler.h"
+
+/***********************************************************************************************************************
+ * Start with an empty stream
+ **********************************************************************************************************************/
+void FrameAssemblerInit(FrameAssemblerContext *ctx)
+{
+  ctx->frame.bits = 0;
+  ctx->frame.length = 0;
+  ctx->frame.offset = false;
+  ctx->counter = 0;
+}
+
+/***********************************************************************************************************************
+ * Shift a bit received at timeStamp into the actual stream. Returns true if the bit closes a non-empty stream, either by
+ * marking its end or by starting a new one.
+ **********************************************************************************************************************/
+bool FrameAssemblerAdd(FrameAssemblerContext *ctx, BitType bit, uint64_t timeStamp)
+{
+  bool end = false;
+
+  // Stream boundary
+  if((bit & BIT_END) || ((bit & BIT_VALID) && !(bit & BIT_IN_STREAM))) {
+    end = (ctx->frame.length > 0);
+    ctx->frame.bits = 0;
+    ctx->frame.length = 0;
+  }
+
+  // Collect the bit
+  if(bit & BIT_VALID) {
+    ctx->frame.bits = (ctx->frame.bits << 1) | (bit & BIT_ONE);
+    if(ctx->frame.length == 0) {
+      ctx->frame.start = timeStamp;
+    }
+    if(ctx->frame.length <= FRAME_MAX_LENGTH) {
+      ctx->frame.length++;
+    }
+    ctx->frame.end = timeStamp;
+    ctx->times[ctx->counter % FRAME_MAX_LENGTH] = timeStamp;
+    ctx->counter++;
+  }
+
+  return end;
+}
@@ -0,0 +1,165 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef FRAME_ASSEMBLER_H_
+#define FRAME_ASSEMBLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+
+// Longest frame the assembler can hold
+#define FRAME_MAX_LENGTH 64
+
+// Complete frame
+typedef struct {
+  // Bits of the frame, the last received bit is the LSB
+  uint64_t bits;
+  // Number of bits
+  uint8_t length;
+  // Time stamps of the first and the last bit in us
+  uint64_t start;
+  uint64_t end;
+  // Found by the sync word search behind other bits of its stream
+  bool offset;
+} FrameType;
+
+// Frame assembler context
+typedef struct {
+  // Actual stream, its length saturates above FRAME_MAX_LENGTH. The bits hold the last FRAME_MAX_LENGTH bits.
+  FrameType frame;
+  // Time stamps of the last FRAME_MAX_LENGTH bits, indexed by the bit counter
+  uint64_t times[FRAME_MAX_LENGTH];
+  uint8_t counter;
+} FrameAssemblerContext;
+
+void FrameAssemblerInit(FrameAssemblerContext *ctx);
+bool FrameAssemblerAdd(FrameAssemblerContext *ctx, BitType bit, uint64_t timeStamp);
+
+/***********************************************************************************************************************
+ * Get the last length bits of the actual stream as a frame. The stream must have at least length bits.
+ **********************************************************************************************************************/
+static inline void FrameAssemblerLast(const FrameAssemblerContext *ctx, uint8_t length, FrameType *frame)
+{
+  frame->bits = (length < 64) ? (ctx->frame.bits & ((1ULL << length) - 1)) : ctx->frame.bits;
+  frame->length = length;
+  frame->start = ctx->times[(uint8_t)(ctx->counter - length) % FRAME_MAX_LENGTH];
+  frame->end = ctx->frame.end;
+  frame->offset = (ctx->frame.length > length);
+}
+
+/***********************************************************************************************************************
+ * Extract count bits of a frame, starting at the first th received bit. The first received bit is the MSB.
+ **********************************************************************************************************************/
+static inline uint32_t FrameBits(uint64_t frame, uint8_t length, uint8_t first, uint8_t count)
+{
+  return (frame >> (length - first - count)) & ((1ULL << count) - 1);
+}
+
+/***********************************************************************************************************************
+ * Reverse the bit order of a frame, so the first received bit becomes the LSB
+ **********************************************************************************************************************/
+static inline uint64_t FrameReverse(uint64_t frame, uint8_t length)
+{
+  uint64_t reversed = 0;
+
+  for(uint8_t i = 0; i < length; i++) {
+    reversed = (reversed << 1) | ((frame >> i) & 1);
+  }
+
+  return reversed;
+}
+
+// Field flags
+#define MSB_FIRST                 0
+#define LSB_FIRST                 1
+#define SIGNED                    2
+// Field identifies the sensor (ID, channel, ...)
+#define KEY                       4
+
+// Bits of a field within a frame
+#define FRAME_MASK(length, first, count) ((((uint64_t)1 << (count)) - 1) << ((length) - (first) - (count)))
+
+// Checksum kinds
+#define CHECKSUM_NONE             0
+// The LSB first nibbles of the frame add up to 0xF
+#define CHECKSUM_NIBBLE_SUM       1
+// Even and odd bits of the frame have even parity each
+#define CHECKSUM_PARITY_PAIR      2
+
+/***********************************************************************************************************************
+ * Extract a field of a frame. With constant arguments this folds into a few shifts and masks.
+ **********************************************************************************************************************/
+static inline int32_t FrameField(uint64_t frame, uint8_t length, uint8_t first, uint8_t count, uint8_t flags)
+{
+  uint32_t value = FrameBits(frame, length, first, count);
+
+  if(flags & LSB_FIRST) {
+    value = FrameReverse(value, count);
+  }
+  if((flags & SIGNED) && (value & (1UL << (count - 1)))) {
+    value |= ~((1UL << count) - 1);
+  }
+
+  return (int32_t)value;
+}
+
+/***********************************************************************************************************************
+ * Verify the checksum of a frame
+ **********************************************************************************************************************/
+static inline bool FrameChecksum(uint64_t frame, uint8_t length, uint8_t kind)
+{
+  bool valid = true;
+
+  if(kind == CHECKSUM_NIBBLE_SUM) {
+    uint64_t bits = FrameReverse(frame, length);
+    uint8_t sum = 0;
+
+    for(uint8_t i = 0; i < length; i += 4) {
+      sum += (bits >> i) & 0xF;
+    }
+    valid = ((sum & 0xF) == 0xF);
+  }
+  else if(kind == CHECKSUM_PARITY_PAIR) {
+    uint8_t parity = 0;
+
+    for(uint8_t i = 0; i < length; i++) {
+      parity ^= ((frame >> (length - 1 - i)) & 1) << (i & 1);
+    }
+    valid = (parity == 0);
+  }
+
+  return valid;
+}
+
+#endif // FRAME_ASSEMBLER_H_
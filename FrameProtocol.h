@@ -0,0 +1,251 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Frame protocol template
+ *
+ * Generates the decoder of a frame based protocol from its declarative description. Define the following macros and
+ * include this file, it can be included several times in one translation unit:
+ *
+ *   PROTOCOL_NAME              Protocol name, prefix of the generated identifiers and of the printed messages
+ *   PROTOCOL_BIT_DECODER       Bit decoder description (BitDecoderType)
+ *   PROTOCOL_TIMING            Timing parameters of the bit decoder, array indexed by TimingProfileType
+ *   PROTOCOL_FRAME_LENGTH      Frame length in bits
+ *   PROTOCOL_FRAME_LENGTH_MAX  Longest bit stream accepted, trailing bits are ignored (optional)
+ *   PROTOCOL_PREAMBLE_LENGTH   Number of preamble bits at the beginning of the frame (optional)
+ *   PROTOCOL_PREAMBLE          Value of the preamble bits (optional). Frames with a preamble and a checksum are also
+ *                              found behind other bits of a bit stream, those need at least CONFIRM_OFFSET.
+ *   PROTOCOL_FIELDS(FIELD)     List of FIELD(name, first bit, number of bits, MSB_FIRST / LSB_FIRST [| SIGNED] [| KEY])
+ *                              Fields flagged with KEY tell the sensors apart for the duplicate filter.
+ *   PROTOCOL_CHECKSUM          Checksum kind (optional, see FrameAssembler.h)
+ *   PROTOCOL_VALID(data)       Additional check of the decoded fields (optional)
+ *   PROTOCOL_CONFIRM           Default confirmation policy (optional, see Dedup.h), two identical messages in a row
+ *                              if not given
+ *   PROTOCOL_OUTPUT(data)      printf() format and arguments of the text message, without the protocol name
+ *   PROTOCOL_RECORD(data, record)
+ *                              Fills the sensor id, channel, battery status and quantities of the reading (optional,
+ *                              see Output.h)
+ *
+ * Fields are extracted with constant positions, so every protocol gets its own shift and mask code.
+ **********************************************************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+#include "Output.h"
+#include "Dedup.h"
+#include "Protocol.h"
+#include "FrameAssembler.h"
+
+#ifndef FRAME_PROTOCOL_H_
+#define FRAME_PROTOCOL_H_
+
+// Identifier and string building helpers
+#define PROTOCOL_CONCAT2(a, b) a ## b
+#define PROTOCOL_CONCAT(a, b)  PROTOCOL_CONCAT2(a, b)
+#define PROTOCOL_STRING2(a)    #a
+#define PROTOCOL_STRING(a)     PROTOCOL_STRING2(a)
+#define PROTOCOL_ID(suffix)    PROTOCOL_CONCAT(PROTOCOL_NAME, suffix)
+
+// Field expansions
+#define PROTOCOL_FIELD_MEMBER(name, first, count, flags) int32_t name;
+#define PROTOCOL_FIELD_EXTRACT(name, first, count, flags) \
+  data->name = FrameField(frame, PROTOCOL_FRAME_LENGTH, first, count, flags);
+#define PROTOCOL_FIELD_MASK(name, first, count, flags) \
+  | FRAME_MASK(PROTOCOL_FRAME_LENGTH, first, count)
+#define PROTOCOL_FIELD_KEY_MASK(name, first, count, flags) \
+  | (((flags) & KEY) ? FRAME_MASK(PROTOCOL_FRAME_LENGTH, first, count) : 0)
+
+#endif // FRAME_PROTOCOL_H_
+
+// Defaults of the optional parameters
+#ifndef PROTOCOL_FRAME_LENGTH_MAX
+#define PROTOCOL_FRAME_LENGTH_MAX PROTOCOL_FRAME_LENGTH
+#endif
+#ifndef PROTOCOL_PREAMBLE_LENGTH
+#define PROTOCOL_PREAMBLE_LENGTH 0
+#define PROTOCOL_PREAMBLE 0
+#endif
+#ifndef PROTOCOL_CHECKSUM
+#define PROTOCOL_CHECKSUM CHECKSUM_NONE
+#endif
+#ifndef PROTOCOL_VALID
+#define PROTOCOL_VALID(data) true
+#endif
+#ifndef PROTOCOL_CONFIRM
+#define PROTOCOL_CONFIRM CONFIRM_REPEAT(2, 2)
+#endif
+#ifndef PROTOCOL_RECORD
+#define PROTOCOL_RECORD(data, record)
+#endif
+
+// Decoded data
+typedef struct {
+  PROTOCOL_FIELDS(PROTOCOL_FIELD_MEMBER)
+} PROTOCOL_ID(Data);
+
+// Decoder context
+typedef struct {
+  // Shared environment
+  const ProtocolEnvironmentType *environment;
+  // Confirmation policy of complete streams and of frames found behind other bits
+  DedupPolicyType confirm;
+  DedupPolicyType confirmOffset;
+} PROTOCOL_ID(Context);
+
+// Protocol description
+extern const ProtocolType PROTOCOL_ID(Protocol);
+
+/***********************************************************************************************************************
+ * Message Decoder
+ **********************************************************************************************************************/
+static bool PROTOCOL_ID(Decode)(uint64_t frame, PROTOCOL_ID(Data) *data)
+{
+  // Return value
+  bool retval = false;
+
+  // Preamble
+  if((PROTOCOL_PREAMBLE_LENGTH > 0) &&
+     (FrameBits(frame, PROTOCOL_FRAME_LENGTH, 0, PROTOCOL_PREAMBLE_LENGTH) != PROTOCOL_PREAMBLE)) {
+    goto exit;
+  }
+  // Checksum
+  if(!FrameChecksum(frame, PROTOCOL_FRAME_LENGTH, PROTOCOL_CHECKSUM)) {
+    goto exit;
+  }
+  // Fields
+  PROTOCOL_FIELDS(PROTOCOL_FIELD_EXTRACT)
+  // Field values
+  if(!(PROTOCOL_VALID(data))) {
+    goto exit;
+  }
+  retval = true;
+
+  exit:
+  return retval;
+}
+
+/***********************************************************************************************************************
+ * Initialize decoder context
+ **********************************************************************************************************************/
+static void PROTOCOL_ID(Init)(void *context, const ProtocolEnvironmentType *environment, DedupPolicyType confirm)
+{
+  PROTOCOL_ID(Context) *ctx = context;
+
+  ctx->environment = environment;
+  ctx->confirm = confirm;
+  ctx->confirmOffset = DedupPolicyAtLeast(confirm, (DedupPolicyType)CONFIRM_OFFSET);
+}
+
+/***********************************************************************************************************************
+ * Process a frame
+ **********************************************************************************************************************/
+static bool PROTOCOL_ID(Parse)(void *context, const FrameType *frame)
+{
+  PROTOCOL_ID(Context) *ctx = context;
+  const ProtocolEnvironmentType *environment = ctx->environment;
+  // Frame bits, trailing ones cut
+  uint64_t bits = frame->bits >> (frame->length - PROTOCOL_FRAME_LENGTH);
+  // Decoded data
+  PROTOCOL_ID(Data) data;
+  // Decode frame
+  bool valid = PROTOCOL_ID(Decode)(bits, &data);
+
+  // The message consists of all field bits, the key of the sensor identifying ones
+  if(valid && DedupCheck(environment->dedup, &PROTOCOL_ID(Protocol),
+    bits & (0 PROTOCOL_FIELDS(PROTOCOL_FIELD_KEY_MASK)), bits & (0 PROTOCOL_FIELDS(PROTOCOL_FIELD_MASK)),
+    frame->end, frame->offset ? ctx->confirmOffset : ctx->confirm)) {
+    OutputRecordType record = {
+      .protocol = &PROTOCOL_ID(Protocol), .tag = environment->tag, .id = -1, .channel = -1,
+      .battery = BatteryUnknown, .present = 0, .start = frame->start, .end = frame->end,
+      .frame = bits, .frameLength = PROTOCOL_FRAME_LENGTH
+    };
+
+    PROTOCOL_RECORD((&data), (&record))
+    OutputRecord(&environment->output, &record);
+  }
+
+  return valid;
+}
+
+/***********************************************************************************************************************
+ * Print a reading in the text format of the protocol. The fields are extracted again from the frame, so this costs
+ * nothing unless the text is needed.
+ **********************************************************************************************************************/
+static int PROTOCOL_ID(Format)(const OutputRecordType *record, char *text, size_t size)
+{
+  uint64_t frame = record->frame;
+  PROTOCOL_ID(Data) fields;
+  PROTOCOL_ID(Data) *data = &fields;
+
+  // The frame has been checked already
+  PROTOCOL_FIELDS(PROTOCOL_FIELD_EXTRACT)
+
+  return snprintf(text, size, PROTOCOL_STRING(PROTOCOL_NAME) " " PROTOCOL_OUTPUT(data));
+}
+
+/***********************************************************************************************************************
+ * Protocol description
+ **********************************************************************************************************************/
+const ProtocolType PROTOCOL_ID(Protocol) = {
+  .name = PROTOCOL_STRING(PROTOCOL_NAME),
+  .bitDecoder = &PROTOCOL_BIT_DECODER,
+  .timing = { &PROTOCOL_TIMING[TimingDigital], &PROTOCOL_TIMING[TimingAnalog] },
+  .contextSize = sizeof(PROTOCOL_ID(Context)),
+  .init = PROTOCOL_ID(Init),
+  .parse = PROTOCOL_ID(Parse),
+  .frameLength = PROTOCOL_FRAME_LENGTH,
+  .frameLengthMax = PROTOCOL_FRAME_LENGTH_MAX,
+  // Without a checksum the field checks are no match for the candidates of a search at every bit
+  .syncLength = (PROTOCOL_CHECKSUM != CHECKSUM_NONE) ? PROTOCOL_PREAMBLE_LENGTH : 0,
+  .sync = PROTOCOL_PREAMBLE,
+  .confirm = PROTOCOL_CONFIRM,
+  .format = PROTOCOL_ID(Format)
+};
+
+// Ready for the next protocol
+#undef PROTOCOL_NAME
+#undef PROTOCOL_BIT_DECODER
+#undef PROTOCOL_TIMING
+#undef PROTOCOL_FRAME_LENGTH
+#undef PROTOCOL_FRAME_LENGTH_MAX
+#undef PROTOCOL_PREAMBLE_LENGTH
+#undef PROTOCOL_PREAMBLE
+#undef PROTOCOL_FIELDS
+#undef PROTOCOL_CHECKSUM
+#undef PROTOCOL_VALID
+#undef PROTOCOL_CONFIRM
+#undef PROTOCOL_OUTPUT
+#undef PROTOCOL_RECORD
@@ -0,0 +1,733 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "TimeStamp.h"
+#include "Protocol.h"
+#include "Mqtt.h"
+
+// Control packet types (first byte of the fixed header)
+#define MQTT_CONNECT              0x10
+#define MQTT_CONNACK              0x20
+#define MQTT_PUBLISH              0x30
+#define MQTT_PUBACK               0x40
+#define MQTT_PINGREQ              0xC0
+#define MQTT_PINGRESP             0xD0
+#define MQTT_DISCONNECT           0xE0
+// Publish flags
+#define MQTT_DUP                  0x08
+#define MQTT_RETAIN               0x01
+// Connect flags: user name, password, will retain, will QoS 1, will flag (clean session is not set)
+#define MQTT_CONNECT_USER         0x80
+#define MQTT_CONNECT_PASSWORD     0x40
+#define MQTT_CONNECT_WILL         (0x20 | 0x08 | 0x04)
+// Queue index mask
+#define MQTT_QUEUE_MASK           (MQTT_QUEUE_SIZE - 1)
+
+/***********************************************************************************************************************
+ * Close the connection and schedule the next attempt. QoS 1 publishes not acknowledged yet are sent again as
+ * duplicates on the next connection, the session of the server is kept.
+ **********************************************************************************************************************/
+static void MqttDisconnect(MqttContext *ctx)
+{
+  if(ctx->fd >= 0) {
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+  ctx->connecting = false;
+  ctx->connected = false;
+  ctx->awaiting = false;
+  ctx->outputLength = 0;
+  ctx->inputLength = 0;
+
+  for(uint32_t i = ctx->tail; i != ctx->next; i++) {
+    MqttMessageType *message = &ctx->queue[i & MQTT_QUEUE_MASK];
+
+    if(message->sent && !message->acknowledged) {
+      message->packet[0] |= MQTT_DUP;
+      message->sent = false;
+    }
+  }
+  ctx->next = ctx->tail;
+  ctx->inflight = 0;
+
+  ctx->nextAttempt = TimeStampMonotonic() + ctx->backoff * 1000ULL;
+  ctx->backoff = (ctx->backoff * 2 > MQTT_BACKOFF_MAX) ? MQTT_BACKOFF_MAX : ctx->backoff * 2;
+}
+
+/***********************************************************************************************************************
+ * Start connecting without blocking
+ **********************************************************************************************************************/
+static void MqttConnect(MqttContext *ctx)
+{
+  struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+  struct addrinfo *addresses = NULL;
+
+  if(getaddrinfo(ctx->host, ctx->port, &hints, &addresses) != 0) {
+    goto exit;
+  }
+  ctx->fd = socket(addresses->ai_family, addresses->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+    addresses->ai_protocol);
+  if(ctx->fd < 0) {
+    goto exit;
+  }
+  // The MQTT connection is set up once the TCP connection is established
+  if((connect(ctx->fd, addresses->ai_addr, addresses->ai_addrlen) == 0) || (errno == EINPROGRESS)) {
+    ctx->connecting = true;
+  }
+  else {
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+
+  exit:
+  if(addresses != NULL) {
+    freeaddrinfo(addresses);
+  }
+  if(ctx->fd < 0) {
+    MqttDisconnect(ctx);
+  }
+}
+
+/***********************************************************************************************************************
+ * Encode the remaining length of a packet, returns the number of bytes
+ **********************************************************************************************************************/
+static size_t MqttPutLength(uint8_t *buffer, size_t length)
+{
+  size_t count = 0;
+
+  do {
+    buffer[count] = length & 0x7F;
+    length >>= 7;
+    if(length > 0) {
+      buffer[count] |= 0x80;
+    }
+    count++;
+  } while(length > 0);
+
+  return count;
+}
+
+/***********************************************************************************************************************
+ * Encode a string with its length, returns the number of bytes
+ **********************************************************************************************************************/
+static size_t MqttPutString(uint8_t *buffer, const char *string)
+{
+  size_t length = strlen(string);
+
+  buffer[0] = length >> 8;
+  buffer[1] = length & 0xFF;
+  memcpy(buffer + 2, string, length);
+
+  return length + 2;
+}
+
+/***********************************************************************************************************************
+ * Append a packet to the bytes to be written, returns false if it does not fit
+ **********************************************************************************************************************/
+static bool MqttOutput(MqttContext *ctx, const uint8_t *packet, size_t length)
+{
+  if((ctx->outputLength + length) > sizeof(ctx->output)) {
+    return false;
+  }
+  memcpy(ctx->output + ctx->outputLength, packet, length);
+  ctx->outputLength += length;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Queue the CONNECT packet: persistent session, the status topic turns "offline" if the connection is lost
+ **********************************************************************************************************************/
+static void MqttSendConnect(MqttContext *ctx)
+{
+  uint8_t body[512];
+  uint8_t packet[sizeof(body) + 5];
+  uint8_t flags = MQTT_CONNECT_WILL;
+  size_t length = 0;
+  size_t header;
+
+  // A password is only allowed with a user name
+  if(ctx->user[0] != 0) {
+    flags |= MQTT_CONNECT_USER;
+    if(ctx->password[0] != 0) {
+      flags |= MQTT_CONNECT_PASSWORD;
+    }
+  }
+
+  // Protocol name, level 4 (3.1.1), flags and keep alive
+  length += MqttPutString(body + length, "MQTT");
+  body[length++] = 4;
+  body[length++] = flags;
+  body[length++] = ctx->keepAlive >> 8;
+  body[length++] = ctx->keepAlive & 0xFF;
+  // Client id, will, credentials
+  length += MqttPutString(body + length, ctx->client);
+  length += MqttPutString(body + length, ctx->status);
+  length += MqttPutString(body + length, "offline");
+  if(flags & MQTT_CONNECT_USER) {
+    length += MqttPutString(body + length, ctx->user);
+  }
+  if(flags & MQTT_CONNECT_PASSWORD) {
+    length += MqttPutString(body + length, ctx->password);
+  }
+
+  packet[0] = MQTT_CONNECT;
+  header = 1 + MqttPutLength(packet + 1, length);
+  memcpy(packet + header, body, length);
+  MqttOutput(ctx, packet, header + length);
+}
+
+/***********************************************************************************************************************
+ * Encode a retained PUBLISH packet, returns its length or 0 if it does not fit into MQTT_PACKET_SIZE bytes
+ **********************************************************************************************************************/
+static size_t MqttEncodePublish(uint8_t *packet, const char *topic, const char *payload, uint8_t qos, uint16_t id)
+{
+  size_t payloadLength = strlen(payload);
+  size_t length = 2 + strlen(topic) + ((qos > 0) ? 2 : 0) + payloadLength;
+  size_t header;
+
+  // The fixed header has at most 3 bytes for this size
+  if((length + 3) > MQTT_PACKET_SIZE) {
+    return 0;
+  }
+
+  packet[0] = MQTT_PUBLISH | (qos << 1) | MQTT_RETAIN;
+  header = 1 + MqttPutLength(packet + 1, length);
+  header += MqttPutString(packet + header, topic);
+  if(qos > 0) {
+    packet[header++] = id >> 8;
+    packet[header++] = id & 0xFF;
+  }
+  memcpy(packet + header, payload, payloadLength);
+
+  return header + payloadLength;
+}
+
+/***********************************************************************************************************************
+ * Queue a retained publish. The oldest publish is dropped if the queue is full.
+ **********************************************************************************************************************/
+static void MqttPublish(MqttContext *ctx, const char *topic, const char *payload)
+{
+  MqttMessageType *message;
+
+  ctx->publishes++;
+
+  if((ctx->head - ctx->tail) >= MQTT_QUEUE_SIZE) {
+    message = &ctx->queue[ctx->tail & MQTT_QUEUE_MASK];
+    // An acknowledgement for it is ignored later
+    if(message->sent) {
+      ctx->inflight--;
+    }
+    if(ctx->next == ctx->tail) {
+      ctx->next++;
+    }
+    ctx->tail++;
+    ctx->dropped++;
+  }
+
+  message = &ctx->queue[ctx->head & MQTT_QUEUE_MASK];
+  message->id = 0;
+  if(ctx->qos > 0) {
+    // Packet identifiers must not be 0
+    if(++ctx->packetId == 0) {
+      ctx->packetId = 1;
+    }
+    message->id = ctx->packetId;
+  }
+  message->length = MqttEncodePublish(message->packet, topic, payload, ctx->qos, message->id);
+  if(message->length == 0) {
+    ctx->dropped++;
+    return;
+  }
+  message->sent = false;
+  message->acknowledged = false;
+  ctx->head++;
+}
+
+/***********************************************************************************************************************
+ * Release the publishes at the beginning of the queue that need no more acknowledgement
+ **********************************************************************************************************************/
+static void MqttRelease(MqttContext *ctx)
+{
+  while((ctx->tail != ctx->next) && ctx->queue[ctx->tail & MQTT_QUEUE_MASK].acknowledged) {
+    ctx->tail++;
+  }
+}
+
+/***********************************************************************************************************************
+ * Handle a PUBACK. The server acknowledges in order, so the publish is normally the oldest one.
+ **********************************************************************************************************************/
+static void MqttAcknowledge(MqttContext *ctx, uint16_t id)
+{
+  for(uint32_t i = ctx->tail; i != ctx->next; i++) {
+    MqttMessageType *message = &ctx->queue[i & MQTT_QUEUE_MASK];
+
+    if(message->sent && !message->acknowledged && (message->id == id)) {
+      message->acknowledged = true;
+      ctx->inflight--;
+      ctx->acknowledged++;
+      break;
+    }
+  }
+  MqttRelease(ctx);
+}
+
+/***********************************************************************************************************************
+ * Read and handle the packets of the server. Returns false if the connection is lost.
+ **********************************************************************************************************************/
+static bool MqttReceive(MqttContext *ctx)
+{
+  uint8_t packet[MQTT_PACKET_SIZE];
+  size_t status;
+
+  for(;;) {
+    ssize_t received = recv(ctx->fd, ctx->input + ctx->inputLength, sizeof(ctx->input) - ctx->inputLength,
+      MSG_DONTWAIT);
+
+    if(received == 0) {
+      return false;
+    }
+    if(received < 0) {
+      return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+    }
+    ctx->inputLength += received;
+    ctx->lastReceived = TimeStampMonotonic();
+
+    // Complete packets: the server only sends short ones, with a single length byte
+    while(ctx->inputLength >= 2) {
+      size_t length = 2 + ctx->input[1];
+
+      if(ctx->input[1] & 0x80) {
+        return false;
+      }
+      if(ctx->inputLength < length) {
+        break;
+      }
+      switch(ctx->input[0] & 0xF0) {
+        case MQTT_CONNACK: {
+          if((length < 4) || (ctx->input[3] != 0)) {
+            fprintf(stderr, "MQTT %s:%s: connection refused (%u)\n", ctx->host, ctx->port,
+              (length < 4) ? 255 : ctx->input[3]);
+            return false;
+          }
+          ctx->connected = true;
+          ctx->awaiting = false;
+          ctx->connects++;
+          ctx->backoff = MQTT_BACKOFF_MIN;
+          // Status first, ahead of the queued publishes
+          status = MqttEncodePublish(packet, ctx->status, "online", 0, 0);
+          MqttOutput(ctx, packet, status);
+        }
+        break;
+
+        case MQTT_PUBACK: {
+          if(length >= 4) {
+            MqttAcknowledge(ctx, (ctx->input[2] << 8) | ctx->input[3]);
+          }
+        }
+        break;
+
+        case MQTT_PINGRESP: {
+          ctx->awaiting = false;
+        }
+        break;
+
+        default:
+        break;
+      }
+      ctx->inputLength -= length;
+      memmove(ctx->input, ctx->input + length, ctx->inputLength);
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Copy a setting value, returns false if it is too long
+ **********************************************************************************************************************/
+static bool MqttSetting(char *setting, size_t size, const char *value)
+{
+  if(strlen(value) >= size) {
+    return false;
+  }
+  strcpy(setting, value);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Parse the settings: host[:port][,prefix=...][,client=...][,qos=0|1][,keepalive=s][,user=...][,password=...] and
+ * start with no connection, it is established with the first flush
+ **********************************************************************************************************************/
+bool MqttInit(MqttContext *ctx, const char *settings)
+{
+  char copy[512];
+  char *save = NULL;
+  char *address;
+  char *separator;
+  const char *port;
+
+  if(strlen(settings) >= sizeof(copy)) {
+    fprintf(stderr, "MQTT settings too long: %s\n", settings);
+    return false;
+  }
+  strcpy(copy, settings);
+
+  strcpy(ctx->prefix, MQTT_DEFAULT_PREFIX);
+  strcpy(ctx->client, MQTT_DEFAULT_CLIENT);
+  ctx->qos = 1;
+  ctx->keepAlive = MQTT_DEFAULT_KEEPALIVE;
+  ctx->user[0] = 0;
+  ctx->password[0] = 0;
+
+  // Address
+  address = strtok_r(copy, ",", &save);
+  separator = (address != NULL) ? strrchr(address, ':') : NULL;
+  if(separator != NULL) {
+    *separator = 0;
+  }
+  port = separator ? (separator + 1) : MQTT_DEFAULT_PORT;
+  if((address == NULL) || (*address == 0) || !MqttSetting(ctx->host, sizeof(ctx->host), address) || (*port == 0) ||
+     !MqttSetting(ctx->port, sizeof(ctx->port), port)) {
+    fprintf(stderr, "Invalid MQTT address: %s\n", settings);
+    return false;
+  }
+
+  // Options
+  for(char *option = strtok_r(NULL, ",", &save); option != NULL; option = strtok_r(NULL, ",", &save)) {
+    char *value = strchr(option, '=');
+    bool valid = false;
+
+    if(value != NULL) {
+      *value++ = 0;
+      if(!strcmp(option, "prefix")) {
+        valid = (*value != 0) && MqttSetting(ctx->prefix, sizeof(ctx->prefix), value);
+      }
+      else if(!strcmp(option, "client")) {
+        valid = (*value != 0) && MqttSetting(ctx->client, sizeof(ctx->client), value);
+      }
+      else if(!strcmp(option, "user")) {
+        valid = MqttSetting(ctx->user, sizeof(ctx->user), value);
+      }
+      else if(!strcmp(option, "password")) {
+        valid = MqttSetting(ctx->password, sizeof(ctx->password), value);
+      }
+      else if(!strcmp(option, "qos")) {
+        valid = !strcmp(value, "0") || !strcmp(value, "1");
+        ctx->qos = atoi(value);
+      }
+      else if(!strcmp(option, "keepalive")) {
+        char *end;
+        unsigned long keepAlive = strtoul(value, &end, 10);
+
+        valid = (*value != 0) && (*end == 0) && (keepAlive >= 5) && (keepAlive <= 65535);
+        ctx->keepAlive = keepAlive;
+      }
+    }
+    if(!valid) {
+      fprintf(stderr, "Invalid MQTT setting: %s%s%s\n", option, value ? "=" : "", value ? value : "");
+      return false;
+    }
+  }
+  if((ctx->password[0] != 0) && (ctx->user[0] == 0)) {
+    fprintf(stderr, "MQTT password given without user\n");
+    return false;
+  }
+  snprintf(ctx->status, sizeof(ctx->status), "%s/status", ctx->prefix);
+
+  ctx->fd = -1;
+  ctx->connecting = false;
+  ctx->connected = false;
+  ctx->nextAttempt = 0;
+  ctx->backoff = MQTT_BACKOFF_MIN;
+  ctx->awaiting = false;
+  ctx->head = 0;
+  ctx->next = 0;
+  ctx->tail = 0;
+  ctx->inflight = 0;
+  ctx->packetId = 0;
+  ctx->outputLength = 0;
+  ctx->inputLength = 0;
+  ctx->publishes = 0;
+  ctx->acknowledged = 0;
+  ctx->writes = 0;
+  ctx->dropped = 0;
+  ctx->connects = 0;
+  pthread_mutex_init(&ctx->lock, NULL);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Queue the quantities and the battery status of a reading as retained publishes, one topic per value:
+ * prefix/protocol/id[/channel]/quantity
+ **********************************************************************************************************************/
+void MqttRecord(MqttContext *ctx, const OutputRecordType *record)
+{
+  static const char *quantities[QuantityCount] = { "temperature", "humidity", "switch" };
+  char topic[MQTT_PACKET_SIZE];
+  char value[16];
+  int length;
+
+  length = snprintf(topic, sizeof(topic), "%s/%s/%d", ctx->prefix, record->protocol->name, record->id);
+  if(record->channel >= 0) {
+    length += snprintf(topic + length, sizeof(topic) - length, "/%d", record->channel);
+  }
+  if(length >= (int)(sizeof(topic) - 16)) {
+    ctx->dropped++;
+    return;
+  }
+
+  for(unsigned q = 0; q < QuantityCount; q++) {
+    if(!OutputHas(record, q)) {
+      continue;
+    }
+    if(q == QuantityTemperature) {
+      OutputTenths(value, sizeof(value), record->values[q]);
+    }
+    else if(q == QuantitySwitch) {
+      strcpy(value, record->values[q] ? "on" : "off");
+    }
+    else {
+      snprintf(value, sizeof(value), "%d", record->values[q]);
+    }
+    snprintf(topic + length, sizeof(topic) - length, "/%s", quantities[q]);
+    MqttPublish(ctx, topic, value);
+  }
+  if(record->battery != BatteryUnknown) {
+    snprintf(topic + length, sizeof(topic) - length, "/battery");
+    MqttPublish(ctx, topic, (record->battery == BatteryLow) ? "low" : "ok");
+  }
+
+  // Send early during bursts, before the queue overflows
+  if((ctx->head - ctx->next) >= (MQTT_QUEUE_SIZE / 2)) {
+    MqttFlush(ctx);
+  }
+}
+
+/***********************************************************************************************************************
+ * Keep the connection up and send the queued publishes without waiting for their acknowledgements (up to
+ * MQTT_INFLIGHT of them), as few writes as possible. Never blocks.
+ **********************************************************************************************************************/
+void MqttFlush(MqttContext *ctx)
+{
+  uint64_t now = TimeStampMonotonic();
+
+  // Connect when the backoff delay is over, the connection is kept even without publishes
+  if(ctx->fd < 0) {
+    if(now < ctx->nextAttempt) {
+      return;
+    }
+    MqttConnect(ctx);
+    if(ctx->fd < 0) {
+      return;
+    }
+  }
+
+  // Wait for the TCP connection, then set up the session
+  if(ctx->connecting) {
+    int error = 0;
+    socklen_t size = sizeof(error);
+    struct pollfd pfd = { .fd = ctx->fd, .events = POLLOUT };
+
+    if(poll(&pfd, 1, 0) <= 0) {
+      return;
+    }
+    if((getsockopt(ctx->fd, SOL_SOCKET, SO_ERROR, &error, &size) < 0) || (error != 0)) {
+      MqttDisconnect(ctx);
+      return;
+    }
+    ctx->connecting = false;
+    ctx->lastReceived = now;
+    ctx->awaiting = true;
+    ctx->requestTime = now;
+    MqttSendConnect(ctx);
+  }
+
+  if(!MqttReceive(ctx)) {
+    MqttDisconnect(ctx);
+    return;
+  }
+  // The server answers the CONNECT and the pings within the keep alive interval
+  if(ctx->awaiting && ((ctx->requestTime + (ctx->keepAlive * 1000000ULL)) < now)) {
+    fprintf(stderr, "MQTT %s:%s: no answer from the server\n", ctx->host, ctx->port);
+    MqttDisconnect(ctx);
+    return;
+  }
+
+  if(ctx->connected) {
+    // Publishes, QoS 0 ones are done once they are written
+    while((ctx->next != ctx->head) && (ctx->inflight < MQTT_INFLIGHT)) {
+      MqttMessageType *message = &ctx->queue[ctx->next & MQTT_QUEUE_MASK];
+
+      // Acknowledged before the connection was lost
+      if(message->acknowledged) {
+        ctx->next++;
+        continue;
+      }
+      if(!MqttOutput(ctx, message->packet, message->length)) {
+        break;
+      }
+      message->sent = true;
+      if(message->id != 0) {
+        ctx->inflight++;
+      }
+      else {
+        message->acknowledged = true;
+      }
+      ctx->next++;
+    }
+    MqttRelease(ctx);
+
+    // Nothing sent or nothing received for half the keep alive interval: QoS 0 publishes are not answered, the
+    // connection is only known to work while the server answers pings
+    if(!ctx->awaiting && (ctx->outputLength == 0) && (((ctx->lastSent + (ctx->keepAlive * 500000ULL)) <= now) ||
+       ((ctx->lastReceived + (ctx->keepAlive * 500000ULL)) <= now))) {
+      uint8_t ping[] = { MQTT_PINGREQ, 0 };
+
+      MqttOutput(ctx, ping, sizeof(ping));
+      ctx->awaiting = true;
+      ctx->requestTime = now;
+    }
+  }
+
+  // Send as much as the socket takes
+  while(ctx->outputLength > 0) {
+    ssize_t sent = send(ctx->fd, ctx->output, ctx->outputLength, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if(sent < 0) {
+      if((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+        MqttDisconnect(ctx);
+      }
+      return;
+    }
+    ctx->writes++;
+    ctx->lastSent = now;
+    ctx->outputLength -= sent;
+    memmove(ctx->output, ctx->output + sent, ctx->outputLength);
+  }
+}
+
+/***********************************************************************************************************************
+ * Publish the offline status, send the remaining publishes for a while and close the session
+ **********************************************************************************************************************/
+void MqttClose(MqttContext *ctx)
+{
+  uint64_t end = TimeStampMonotonic() + MQTT_CLOSE_TIMEOUT * 1000ULL;
+  uint8_t disconnect[] = { MQTT_DISCONNECT, 0 };
+
+  // A clean disconnect does not publish the will
+  MqttPublish(ctx, ctx->status, "offline");
+  // The first connection attempt is not delayed
+  if(ctx->fd < 0) {
+    ctx->nextAttempt = 0;
+  }
+  while(((ctx->tail != ctx->head) || (ctx->outputLength > 0)) && (TimeStampMonotonic() < end)) {
+    MqttFlush(ctx);
+    if((ctx->tail != ctx->head) || (ctx->outputLength > 0)) {
+      if(ctx->fd >= 0) {
+        struct pollfd pfd = { .fd = ctx->fd, .events = (ctx->outputLength > 0) ? POLLOUT : POLLIN };
+        poll(&pfd, 1, 50);
+      }
+      else {
+        usleep(50000);
+      }
+    }
+  }
+  if(ctx->fd >= 0) {
+    if(ctx->connected && MqttOutput(ctx, disconnect, sizeof(disconnect))) {
+      send(ctx->fd, ctx->output, ctx->outputLength, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+}
+
+/***********************************************************************************************************************
+ * Print statistics
+ **********************************************************************************************************************/
+void MqttPrintStatistics(MqttContext *ctx, FILE *stream)
+{
+  pthread_mutex_lock(&ctx->lock);
+  fprintf(stream, "mqtt %s:%s: %s, %llu publishes, %llu acknowledged, %llu writes, %llu dropped, %llu connects, "
+    "%u queued\n", ctx->host, ctx->port, ctx->connected ? "connected" : "not connected",
+    (unsigned long long)ctx->publishes, (unsigned long long)ctx->acknowledged, (unsigned long long)ctx->writes,
+    (unsigned long long)ctx->dropped, (unsigned long long)ctx->connects, ctx->head - ctx->tail);
+  pthread_mutex_unlock(&ctx->lock);
+}
+
+/***********************************************************************************************************************
+ * Sink callbacks, they run in the sink thread. The lock keeps the statistics consistent.
+ **********************************************************************************************************************/
+static void MqttSinkWrite(void *ctx, const OutputRecordType *record)
+{
+  MqttContext *mqtt = ctx;
+
+  pthread_mutex_lock(&mqtt->lock);
+  MqttRecord(mqtt, record);
+  pthread_mutex_unlock(&mqtt->lock);
+}
+
+static void MqttSinkFlush(void *ctx)
+{
+  MqttContext *mqtt = ctx;
+
+  pthread_mutex_lock(&mqtt->lock);
+  MqttFlush(mqtt);
+  pthread_mutex_unlock(&mqtt->lock);
+}
+
+static void MqttSinkClose(void *ctx)
+{
+  MqttContext *mqtt = ctx;
+
+  pthread_mutex_lock(&mqtt->lock);
+  MqttClose(mqtt);
+  pthread_mutex_unlock(&mqtt->lock);
+}
+
+/***********************************************************************************************************************
+ * Output sink feeding the connection
+ **********************************************************************************************************************/
+OutputSinkType MqttSink(MqttContext *ctx)
+{
+  return (OutputSinkType) {
+    .name = "mqtt", .write = MqttSinkWrite, .flush = MqttSinkFlush, .close = MqttSinkClose, .ctx = ctx
+  };
+}
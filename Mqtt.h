@@ -0,0 +1,134 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef MQTT_H_
+#define MQTT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "Output.h"
+
+// Default MQTT port, topic prefix and client id
+#define MQTT_DEFAULT_PORT         "1883"
+#define MQTT_DEFAULT_PREFIX       "weather_rx"
+#define MQTT_DEFAULT_CLIENT       "weather_rx"
+// Default keep alive interval in s
+#define MQTT_DEFAULT_KEEPALIVE    60
+// Longest publish packet
+#define MQTT_PACKET_SIZE          192
+// Publishes kept until they are sent (QoS 0) or acknowledged (QoS 1), power of two. The oldest ones are dropped
+// while the queue is full.
+#define MQTT_QUEUE_SIZE           1024
+// Most QoS 1 publishes sent without acknowledgement
+#define MQTT_INFLIGHT             64
+// Bytes written to the socket at once
+#define MQTT_BUFFER_SIZE          16384
+// Reconnect delays in ms, doubled after every failed attempt
+#define MQTT_BACKOFF_MIN          1000
+#define MQTT_BACKOFF_MAX          60000
+// Time given to send the remaining publishes on close in ms
+#define MQTT_CLOSE_TIMEOUT        1000
+
+// Publish waiting in the queue
+typedef struct {
+  // Packet identifier (QoS 1)
+  uint16_t id;
+  // Sent, waiting for the acknowledgement (QoS 1)
+  bool sent;
+  // Acknowledged out of order, released once it is the oldest one
+  bool acknowledged;
+  // Encoded packet
+  uint16_t length;
+  uint8_t packet[MQTT_PACKET_SIZE];
+} MqttMessageType;
+
+// MQTT connection
+typedef struct {
+  // Server address
+  char host[128];
+  char port[16];
+  // Session: client id, topic prefix, quality of service, keep alive in s and the optional credentials
+  char client[64];
+  char prefix[64];
+  // Status topic: "online" while connected, "offline" (will) otherwise
+  char status[80];
+  uint8_t qos;
+  uint16_t keepAlive;
+  char user[64];
+  char password[64];
+  // Socket, -1 if not connected
+  int fd;
+  // Connection establishment in progress, waiting for the CONNACK
+  bool connecting;
+  bool connected;
+  // Next connection attempt (monotonic time in us) and the delay after a failure in ms
+  uint64_t nextAttempt;
+  uint32_t backoff;
+  // Time of the last packet sent and received
+  uint64_t lastSent;
+  uint64_t lastReceived;
+  // Answer of the server awaited (CONNACK or ping response) and the time its request was sent
+  bool awaiting;
+  uint64_t requestTime;
+  // Queued publishes: tail is the oldest, next the first one not sent yet
+  MqttMessageType queue[MQTT_QUEUE_SIZE];
+  uint32_t head;
+  uint32_t next;
+  uint32_t tail;
+  uint32_t inflight;
+  uint16_t packetId;
+  // Bytes to be written and received bytes of an incomplete packet
+  uint8_t output[MQTT_BUFFER_SIZE];
+  size_t outputLength;
+  uint8_t input[256];
+  size_t inputLength;
+  // Statistics
+  uint64_t publishes;
+  uint64_t acknowledged;
+  uint64_t writes;
+  uint64_t dropped;
+  uint64_t connects;
+  // Protects the connection against the statistics printed by another thread
+  pthread_mutex_t lock;
+} MqttContext;
+
+bool MqttInit(MqttContext *ctx, const char *settings);
+void MqttRecord(MqttContext *ctx, const OutputRecordType *record);
+void MqttFlush(MqttContext *ctx);
+void MqttClose(MqttContext *ctx);
+void MqttPrintStatistics(MqttContext *ctx, FILE *stream);
+OutputSinkType MqttSink(MqttContext *ctx);
+
+#endif // MQTT_H_
@@ -0,0 +1,501 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "Output.h"
+
+// Slot index mask
+#define SLOT_MASK                 (OUTPUT_QUEUE_SLOTS - 1)
+
+// Queue of a sink and the thread feeding the sink from it
+typedef struct {
+  OutputSinkType sink;
+  OutputPolicyType policy;
+  // Readings, the number of slots is a power of two
+  OutputRecordType *slots;
+  unsigned size;
+  // Free running indices: head is written by the output stage, tail by the sink thread and by the output stage
+  // dropping the oldest reading
+  _Alignas(64) atomic_uint head;
+  _Alignas(64) atomic_uint tail;
+  // Index plus one of the reading the sink thread is copying, 0 if none
+  atomic_uint copying;
+  // Readings queued since the sink thread was woken up (output stage only)
+  unsigned pending;
+  // Wakes up the sink thread
+  int wakeFd;
+  // Stop request to the sink thread
+  atomic_bool stop;
+  pthread_t thread;
+  // Statistics: highest fill level, readings written and dropped
+  atomic_uint highWater;
+  atomic_ulong written;
+  atomic_ulong dropped;
+} OutputSinkContext;
+
+// Queue setting of the sinks with a name
+typedef struct {
+  char name[16];
+  OutputPolicyType policy;
+  unsigned size;
+} OutputQueueConfigType;
+
+// Policy names
+static const char *outputPolicies[] = { "block", "drop-oldest", "drop-newest" };
+
+// Sinks of the output stage
+static OutputSinkContext outputSinks[OUTPUT_MAX_SINKS];
+static unsigned outputSinkCount = 0;
+// Sink threads running
+static bool outputStarted = false;
+// Queue settings
+static OutputQueueConfigType outputQueues[OUTPUT_MAX_SINKS];
+static unsigned outputQueueCount = 0;
+
+/***********************************************************************************************************************
+ * Pass a decoded reading on. With a queue, it is passed to the output stage, waiting while the queue is full. With a
+ * list, it is collected for the output stage. Otherwise it goes to the output stage directly, this is only allowed in
+ * the thread running it.
+ **********************************************************************************************************************/
+void OutputRecord(const OutputTargetType *target, const OutputRecordType *record)
+{
+  OutputQueueType *queue = target->queue;
+  OutputListType *list = target->list;
+
+  // Queue message
+  if(queue != NULL) {
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    OutputMessageType *message = &queue->slots[head & SLOT_MASK];
+
+    // Messages are rare, a full queue means the output stage is blocked: kick it and retry
+    while((head - atomic_load_explicit(&queue->tail, memory_order_acquire)) >= OUTPUT_QUEUE_SLOTS) {
+      uint64_t wake = 1;
+      struct timespec delay = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+      if(write(queue->wakeFd, &wake, sizeof(wake)) == -1) {
+        perror("eventfd");
+      }
+      nanosleep(&delay, NULL);
+    }
+
+    message->sequence = queue->sequence;
+    message->record = *record;
+
+    // Publish the message after its contents
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  }
+  // Collect message
+  else if(list != NULL) {
+    if(list->count >= list->size) {
+      list->size = list->size ? (list->size * 2) : 64;
+      list->records = realloc(list->records, list->size * sizeof(OutputRecordType));
+      if(list->records == NULL) {
+        perror("realloc()");
+        exit(EXIT_FAILURE);
+      }
+    }
+    list->records[list->count++] = *record;
+  }
+  // Output stage
+  else {
+    OutputDeliver(record);
+  }
+}
+
+/***********************************************************************************************************************
+ * Start with an empty queue
+ **********************************************************************************************************************/
+void OutputQueueInit(OutputQueueType *queue, int wakeFd)
+{
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  queue->sequence = 0;
+  queue->wakeFd = wakeFd;
+}
+
+/***********************************************************************************************************************
+ * Oldest message in the queue (consumer only), NULL if the queue is empty
+ **********************************************************************************************************************/
+const OutputMessageType *OutputQueueFront(OutputQueueType *queue)
+{
+  unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+  return (head != tail) ? &queue->slots[tail & SLOT_MASK] : NULL;
+}
+
+/***********************************************************************************************************************
+ * Release the oldest message (consumer only)
+ **********************************************************************************************************************/
+void OutputQueuePop(OutputQueueType *queue)
+{
+  unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+}
+
+/***********************************************************************************************************************
+ * Set the queue policies of sinks from a list: name=policy[:slots][,name=policy[:slots] ...]. Policies are block,
+ * drop-oldest and drop-newest, the number of slots is a power of two.
+ **********************************************************************************************************************/
+bool OutputConfigQueues(const char *list)
+{
+  char copy[256];
+  char *save = NULL;
+
+  if(strlen(list) >= sizeof(copy)) {
+    fprintf(stderr, "Queue list too long: %s\n", list);
+    return false;
+  }
+  strcpy(copy, list);
+
+  for(char *entry = strtok_r(copy, ",", &save); entry != NULL; entry = strtok_r(NULL, ",", &save)) {
+    char *policy = strchr(entry, '=');
+    char *size = NULL;
+    OutputQueueConfigType *config = NULL;
+    unsigned p;
+
+    if(policy == NULL) {
+      fprintf(stderr, "Invalid queue setting: %s (output=policy[:slots])\n", entry);
+      return false;
+    }
+    *policy++ = 0;
+    size = strchr(policy, ':');
+    if(size != NULL) {
+      *size++ = 0;
+    }
+
+    if((*entry == 0) || (strlen(entry) >= sizeof(config->name))) {
+      fprintf(stderr, "Invalid output name: %s\n", entry);
+      return false;
+    }
+    // A later setting of the same output replaces the earlier one
+    for(unsigned q = 0; q < outputQueueCount; q++) {
+      if(!strcmp(outputQueues[q].name, entry)) {
+        config = &outputQueues[q];
+      }
+    }
+    if(config == NULL) {
+      if(outputQueueCount >= OUTPUT_MAX_SINKS) {
+        fprintf(stderr, "Too many queue settings (max. %u)\n", OUTPUT_MAX_SINKS);
+        return false;
+      }
+      config = &outputQueues[outputQueueCount++];
+      strcpy(config->name, entry);
+    }
+
+    for(p = 0; p < (sizeof(outputPolicies) / sizeof(outputPolicies[0])); p++) {
+      if(!strcmp(policy, outputPolicies[p])) {
+        break;
+      }
+    }
+    if(p >= (sizeof(outputPolicies) / sizeof(outputPolicies[0]))) {
+      fprintf(stderr, "Unknown queue policy: %s (block, drop-oldest, drop-newest)\n", policy);
+      return false;
+    }
+    config->policy = p;
+
+    config->size = OUTPUT_SINK_SLOTS;
+    if(size != NULL) {
+      char *end;
+      unsigned long slots = strtoul(size, &end, 10);
+
+      if((*size == 0) || (*end != 0) || (slots < 2) || (slots > (1UL << 20)) || (slots & (slots - 1))) {
+        fprintf(stderr, "Invalid queue size: %s (power of two, 2 .. %lu)\n", size, 1UL << 20);
+        return false;
+      }
+      config->size = slots;
+    }
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Feed the readings of the output stage to a sink as well. Must be called before the output stage is started.
+ **********************************************************************************************************************/
+void OutputAddSink(const OutputSinkType *sink)
+{
+  if(outputSinkCount >= OUTPUT_MAX_SINKS) {
+    fprintf(stderr, "Too many outputs (max. %u)\n", OUTPUT_MAX_SINKS);
+    exit(EXIT_FAILURE);
+  }
+  outputSinks[outputSinkCount++].sink = *sink;
+}
+
+/***********************************************************************************************************************
+ * Wake up the thread of a sink
+ **********************************************************************************************************************/
+static void OutputSinkWake(OutputSinkContext *ctx)
+{
+  uint64_t wake = 1;
+
+  if(write(ctx->wakeFd, &wake, sizeof(wake)) == -1) {
+    perror("eventfd");
+  }
+  ctx->pending = 0;
+}
+
+/***********************************************************************************************************************
+ * Take the oldest reading from the queue of a sink (sink thread). The reading is copied before it is released, the
+ * output stage dropping it meanwhile waits for the copy.
+ **********************************************************************************************************************/
+static bool OutputSinkPop(OutputSinkContext *ctx, OutputRecordType *record)
+{
+  for(;;) {
+    unsigned tail = atomic_load(&ctx->tail);
+
+    if(tail == atomic_load_explicit(&ctx->head, memory_order_acquire)) {
+      return false;
+    }
+
+    // Announce the copy, then make sure the reading was not dropped before
+    atomic_store(&ctx->copying, tail + 1);
+    if(atomic_load(&ctx->tail) == tail) {
+      *record = ctx->slots[tail & (ctx->size - 1)];
+      atomic_store(&ctx->copying, 0);
+      if(atomic_compare_exchange_strong(&ctx->tail, &tail, tail + 1)) {
+        return true;
+      }
+    }
+    else {
+      atomic_store(&ctx->copying, 0);
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Queue a reading for a sink (output stage). A full queue is handled by the policy of the sink. The sink thread is
+ * woken up by OutputFlush() or once half of the queue is filled.
+ **********************************************************************************************************************/
+static void OutputSinkPush(OutputSinkContext *ctx, const OutputRecordType *record)
+{
+  unsigned head = atomic_load_explicit(&ctx->head, memory_order_relaxed);
+  unsigned tail;
+
+  for(;;) {
+    tail = atomic_load(&ctx->tail);
+    if((head - tail) < ctx->size) {
+      break;
+    }
+
+    if(ctx->policy == OutputDropNewest) {
+      atomic_fetch_add_explicit(&ctx->dropped, 1, memory_order_relaxed);
+      return;
+    }
+    if(ctx->policy == OutputDropOldest) {
+      if(atomic_compare_exchange_strong(&ctx->tail, &tail, tail + 1)) {
+        atomic_fetch_add_explicit(&ctx->dropped, 1, memory_order_relaxed);
+        // The slot is reused right away, the sink thread may still be copying the dropped reading
+        while(atomic_load(&ctx->copying) == (tail + 1)) {
+          sched_yield();
+        }
+        tail++;
+        break;
+      }
+    }
+    else {
+      struct timespec delay = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+      // Kick the sink thread and wait for room
+      OutputSinkWake(ctx);
+      nanosleep(&delay, NULL);
+    }
+  }
+
+  ctx->slots[head & (ctx->size - 1)] = *record;
+  atomic_store_explicit(&ctx->head, head + 1, memory_order_release);
+
+  if((head + 1 - tail) > atomic_load_explicit(&ctx->highWater, memory_order_relaxed)) {
+    atomic_store_explicit(&ctx->highWater, head + 1 - tail, memory_order_relaxed);
+  }
+  if(++ctx->pending >= (ctx->size / 2)) {
+    OutputSinkWake(ctx);
+  }
+}
+
+/***********************************************************************************************************************
+ * Sink thread: write the queued readings, then flush the sink. Wakes up at least every OUTPUT_FLUSH_INTERVAL ms, so
+ * sinks can do their housekeeping (e.g. reconnect).
+ **********************************************************************************************************************/
+static void *OutputSinkThread(void *arg)
+{
+  OutputSinkContext *ctx = arg;
+  struct pollfd pfd = { .fd = ctx->wakeFd, .events = POLLIN };
+  OutputRecordType record;
+  bool stop = false;
+
+  while(!stop) {
+    uint64_t wake;
+
+    // Everything queued before the stop request is still written
+    stop = atomic_load(&ctx->stop);
+    while(OutputSinkPop(ctx, &record)) {
+      ctx->sink.write(ctx->sink.ctx, &record);
+      atomic_fetch_add_explicit(&ctx->written, 1, memory_order_relaxed);
+    }
+    if(ctx->sink.flush != NULL) {
+      ctx->sink.flush(ctx->sink.ctx);
+    }
+
+    if(!stop && (poll(&pfd, 1, OUTPUT_FLUSH_INTERVAL) > 0) && (read(ctx->wakeFd, &wake, sizeof(wake)) == -1)) {
+      perror("eventfd");
+    }
+  }
+
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Start the sink threads. Sinks without a queue setting get the given policy and OUTPUT_SINK_SLOTS slots.
+ **********************************************************************************************************************/
+void OutputStart(OutputPolicyType policy)
+{
+  sigset_t all, previous;
+  int error = 0;
+
+  // Signals are handled by the calling thread only, the threads inherit the blocked signals
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &previous);
+  for(unsigned s = 0; (s < outputSinkCount) && (error == 0); s++) {
+    OutputSinkContext *ctx = &outputSinks[s];
+
+    ctx->policy = policy;
+    ctx->size = OUTPUT_SINK_SLOTS;
+    for(const OutputQueueConfigType *config = outputQueues; config < (outputQueues + outputQueueCount); config++) {
+      if(!strcmp(config->name, ctx->sink.name)) {
+        ctx->policy = config->policy;
+        ctx->size = config->size;
+      }
+    }
+
+    ctx->slots = calloc(ctx->size, sizeof(OutputRecordType));
+    if(ctx->slots == NULL) {
+      perror("calloc()");
+      exit(EXIT_FAILURE);
+    }
+    ctx->wakeFd = eventfd(0, 0);
+    if(ctx->wakeFd == -1) {
+      perror("eventfd()");
+      exit(EXIT_FAILURE);
+    }
+    atomic_init(&ctx->head, 0);
+    atomic_init(&ctx->tail, 0);
+    atomic_init(&ctx->copying, 0);
+    atomic_init(&ctx->stop, false);
+    atomic_init(&ctx->highWater, 0);
+    atomic_init(&ctx->written, 0);
+    atomic_init(&ctx->dropped, 0);
+    ctx->pending = 0;
+
+    error = pthread_create(&ctx->thread, NULL, OutputSinkThread, ctx);
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  if(error != 0) {
+    errno = error;
+    perror("pthread_create()");
+    exit(EXIT_FAILURE);
+  }
+
+  outputStarted = true;
+}
+
+/***********************************************************************************************************************
+ * Output stage: queue a reading for every sink, each one formats it its own way in its own thread
+ **********************************************************************************************************************/
+void OutputDeliver(const OutputRecordType *record)
+{
+  for(unsigned s = 0; s < outputSinkCount; s++) {
+    OutputSinkPush(&outputSinks[s], record);
+  }
+}
+
+/***********************************************************************************************************************
+ * Output stage: let the sinks pass on what was queued since the last call. Readings are batched until then.
+ **********************************************************************************************************************/
+void OutputFlush(void)
+{
+  for(unsigned s = 0; s < outputSinkCount; s++) {
+    if(outputSinks[s].pending > 0) {
+      OutputSinkWake(&outputSinks[s]);
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Output stage: let the sink threads write the queued readings, stop them and release the sinks
+ **********************************************************************************************************************/
+void OutputClose(void)
+{
+  for(unsigned s = 0; s < outputSinkCount; s++) {
+    OutputSinkContext *ctx = &outputSinks[s];
+
+    if(outputStarted) {
+      atomic_store(&ctx->stop, true);
+      OutputSinkWake(ctx);
+      pthread_join(ctx->thread, NULL);
+      close(ctx->wakeFd);
+      free(ctx->slots);
+    }
+    if(ctx->sink.close != NULL) {
+      ctx->sink.close(ctx->sink.ctx);
+    }
+  }
+  outputSinkCount = 0;
+  outputStarted = false;
+}
+
+/***********************************************************************************************************************
+ * Print the queue statistics of the sinks
+ **********************************************************************************************************************/
+void OutputPrintStatistics(FILE *stream)
+{
+  for(unsigned s = 0; outputStarted && (s < outputSinkCount); s++) {
+    OutputSinkContext *ctx = &outputSinks[s];
+    unsigned lag = atomic_load(&ctx->head) - atomic_load(&ctx->tail);
+
+    fprintf(stream, "output %s: %s, %u queued (max. %u of %u), %lu written, %lu dropped\n", ctx->sink.name,
+      outputPolicies[ctx->policy], lag, atomic_load_explicit(&ctx->highWater, memory_order_relaxed), ctx->size,
+      atomic_load_explicit(&ctx->written, memory_order_relaxed),
+      atomic_load_explicit(&ctx->dropped, memory_order_relaxed));
+  }
+}
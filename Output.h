@@ -0,0 +1,191 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Number of messages a queue can hold, power of two
+#define OUTPUT_QUEUE_SLOTS        256
+// Most sinks the output stage feeds: every output format, some of them to several files, plus FHEM and MQTT
+#define OUTPUT_MAX_SINKS          16
+// Default number of readings a sink queue can hold, power of two
+#define OUTPUT_SINK_SLOTS         1024
+// Sinks are flushed at least this often in ms
+#define OUTPUT_FLUSH_INTERVAL     100
+
+// Quantities of a reading
+typedef enum {
+  // Temperature in 0.1 degrees Celsius
+  QuantityTemperature,
+  // Relative humidity in %
+  QuantityHumidity,
+  // Switch state: 0 off, 1 on
+  QuantitySwitch,
+  QuantityCount
+} OutputQuantityType;
+
+// Battery status
+typedef enum {
+  BatteryUnknown,
+  BatteryOk,
+  BatteryLow
+} OutputBatteryType;
+
+// Protocol description (Protocol.h)
+struct ProtocolStruct;
+
+// Decoded reading
+typedef struct OutputRecordStruct {
+  // Protocol and receiver tag (NULL if there is none)
+  const struct ProtocolStruct *protocol;
+  const char *tag;
+  // Sensor id and channel, -1 if the protocol has none
+  int32_t id;
+  int32_t channel;
+  // Battery status
+  uint8_t battery;
+  // Quantities, bit n of present is set if quantity n was received
+  uint8_t present;
+  int32_t values[QuantityCount];
+  // Time stamps of the first and the last bit in us
+  uint64_t start;
+  uint64_t end;
+  // Frame, the first received bit is the MSB
+  uint64_t frame;
+  uint8_t frameLength;
+} OutputRecordType;
+
+// Decoded reading waiting for output
+typedef struct {
+  // Sequence number of the sample batch that completed the message
+  uint64_t sequence;
+  OutputRecordType record;
+} OutputMessageType;
+
+// Lock-free queue of messages from one decoder thread to the output stage
+typedef struct {
+  OutputMessageType slots[OUTPUT_QUEUE_SLOTS];
+  // Free running indices, head is written by the producer, tail by the consumer only
+  _Alignas(64) atomic_uint head;
+  _Alignas(64) atomic_uint tail;
+  // Sequence number of the batch being decoded (producer only)
+  uint64_t sequence;
+  // Event file descriptor waking up the output stage when the queue is full
+  int wakeFd;
+} OutputQueueType;
+
+// Growing list of readings
+typedef struct {
+  OutputRecordType *records;
+  size_t count;
+  size_t size;
+} OutputListType;
+
+// Destination of decoded messages: a queue to the output stage (live decoder threads), a list collected for the output
+// stage (parallel replay) or, if neither is given, the output stage itself
+typedef struct {
+  OutputQueueType *queue;
+  OutputListType *list;
+} OutputTargetType;
+
+// Behaviour of a sink queue when it is full
+typedef enum {
+  // Wait for the sink, nothing is lost
+  OutputBlock,
+  // Throw away the oldest queued reading
+  OutputDropOldest,
+  // Throw away the new reading
+  OutputDropNewest
+} OutputPolicyType;
+
+// Output sink fed by the output stage through its own queue, the callbacks run in the thread of the sink
+typedef struct {
+  // Name the queue policy is configured with
+  const char *name;
+  // Take a reading
+  void (*write)(void *ctx, const OutputRecordType *record);
+  // Pass on what was written since the last flush (optional)
+  void (*flush)(void *ctx);
+  // Flush and release the sink (optional)
+  void (*close)(void *ctx);
+  void *ctx;
+} OutputSinkType;
+
+/***********************************************************************************************************************
+ * Set a quantity of a reading
+ **********************************************************************************************************************/
+static inline void OutputSet(OutputRecordType *record, OutputQuantityType quantity, int32_t value)
+{
+  record->values[quantity] = value;
+  record->present |= 1 << quantity;
+}
+
+/***********************************************************************************************************************
+ * Print a value in 0.1 units with one decimal, like printf("%.1f") prints the value / 10
+ **********************************************************************************************************************/
+static inline int OutputTenths(char *text, size_t size, int32_t tenths)
+{
+  return snprintf(text, size, "%s%d.%d", (tenths < 0) ? "-" : "", abs(tenths) / 10, abs(tenths) % 10);
+}
+
+/***********************************************************************************************************************
+ * Check if a reading has a quantity
+ **********************************************************************************************************************/
+static inline int OutputHas(const OutputRecordType *record, OutputQuantityType quantity)
+{
+  return (record->present >> quantity) & 1;
+}
+
+void OutputRecord(const OutputTargetType *target, const OutputRecordType *record);
+
+void OutputQueueInit(OutputQueueType *queue, int wakeFd);
+const OutputMessageType *OutputQueueFront(OutputQueueType *queue);
+void OutputQueuePop(OutputQueueType *queue);
+
+bool OutputConfigQueues(const char *list);
+void OutputAddSink(const OutputSinkType *sink);
+void OutputStart(OutputPolicyType policy);
+void OutputDeliver(const OutputRecordType *record);
+void OutputFlush(void);
+void OutputClose(void);
+void OutputPrintStatistics(FILE *stream);
+
+#endif // OUTPUT_H_
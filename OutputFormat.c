@@ -0,0 +1,298 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Protocol.h"
+#include "OutputFormat.h"
+#include "ShmRingSink.h"
+
+// Output file of a sink
+typedef struct {
+  FILE *stream;
+} OutputFileType;
+
+// Output format
+typedef struct {
+  // Name in the output list
+  const char *name;
+  // Write a reading to the file
+  void (*write)(void *ctx, const OutputRecordType *record);
+  // Set up a sink that is no file instead, with the target given in the list (NULL if there is none)
+  bool (*open)(const char *target);
+} OutputFormatType;
+
+// Files of the sinks
+static OutputFileType outputFiles[OUTPUT_MAX_SINKS];
+static unsigned outputFileCount = 0;
+
+/***********************************************************************************************************************
+ * Legacy text format: tag (if there is one), protocol name and the fields in the order of the protocol
+ **********************************************************************************************************************/
+static void OutputTextWrite(void *ctx, const OutputRecordType *record)
+{
+  OutputFileType *file = ctx;
+  char text[OUTPUT_TEXT_LENGTH];
+
+  record->protocol->format(record, text, sizeof(text));
+  if(record->tag != NULL) {
+    fprintf(file->stream, "%s %s", record->tag, text);
+  }
+  else {
+    fputs(text, file->stream);
+  }
+}
+
+/***********************************************************************************************************************
+ * Print a JSON string
+ **********************************************************************************************************************/
+static void OutputJsonString(FILE *stream, const char *string)
+{
+  fputc('"', stream);
+  for(; *string != 0; string++) {
+    if((*string == '"') || (*string == '\\')) {
+      fprintf(stream, "\\%c", *string);
+    }
+    else if((unsigned char)*string < 0x20) {
+      fprintf(stream, "\\u%04x", *string);
+    }
+    else {
+      fputc(*string, stream);
+    }
+  }
+  fputc('"', stream);
+}
+
+/***********************************************************************************************************************
+ * JSON Lines: one object per reading, fields the protocol does not have are left out
+ **********************************************************************************************************************/
+static void OutputJsonWrite(void *ctx, const OutputRecordType *record)
+{
+  OutputFileType *file = ctx;
+  FILE *stream = file->stream;
+
+  fprintf(stream, "{\"time\":%llu.%06llu", (unsigned long long)(record->end / 1000000),
+    (unsigned long long)(record->end % 1000000));
+  if(record->tag != NULL) {
+    fputs(",\"tag\":", stream);
+    OutputJsonString(stream, record->tag);
+  }
+  fputs(",\"protocol\":", stream);
+  OutputJsonString(stream, record->protocol->name);
+  if(record->id >= 0) {
+    fprintf(stream, ",\"id\":%d", record->id);
+  }
+  if(record->channel >= 0) {
+    fprintf(stream, ",\"channel\":%d", record->channel);
+  }
+  if(record->battery != BatteryUnknown) {
+    fprintf(stream, ",\"battery\":\"%s\"", (record->battery == BatteryLow) ? "low" : "ok");
+  }
+  if(OutputHas(record, QuantityTemperature)) {
+    char temperature[16];
+
+    OutputTenths(temperature, sizeof(temperature), record->values[QuantityTemperature]);
+    fprintf(stream, ",\"temperature\":%s", temperature);
+  }
+  if(OutputHas(record, QuantityHumidity)) {
+    fprintf(stream, ",\"humidity\":%d", record->values[QuantityHumidity]);
+  }
+  if(OutputHas(record, QuantitySwitch)) {
+    fprintf(stream, ",\"switch\":%d", record->values[QuantitySwitch]);
+  }
+  fprintf(stream, ",\"frame\":\"%0*llx\",\"bits\":%u}\n", (record->frameLength + 3) / 4,
+    (unsigned long long)record->frame, record->frameLength);
+}
+
+/***********************************************************************************************************************
+ * Store an integer in little endian byte order
+ **********************************************************************************************************************/
+static uint8_t *OutputBinaryPut(uint8_t *buffer, uint64_t value, unsigned size)
+{
+  for(unsigned i = 0; i < size; i++) {
+    *buffer++ = value >> (i * 8);
+  }
+
+  return buffer;
+}
+
+/***********************************************************************************************************************
+ * Length of a string cut to a binary record field
+ **********************************************************************************************************************/
+static size_t OutputBinaryLength(const char *string, size_t size)
+{
+  size_t length = strlen(string);
+
+  return (length < size) ? length : size;
+}
+
+/***********************************************************************************************************************
+ * Encode a reading in the binary format: OUTPUT_BINARY_SIZE bytes, all integers little endian
+ *   version, frame length, battery, present quantities (1 byte each)
+ *   id, channel, temperature, humidity, switch (int32 each)
+ *   start, end time stamp in us, frame (uint64 each)
+ *   protocol name (OUTPUT_BINARY_PROTOCOL bytes), tag (OUTPUT_BINARY_TAG bytes), zero padded
+ **********************************************************************************************************************/
+void OutputBinaryEncode(const OutputRecordType *record, uint8_t *buffer)
+{
+  uint8_t *position = buffer;
+
+  memset(buffer, 0, OUTPUT_BINARY_SIZE);
+
+  *position++ = OUTPUT_BINARY_VERSION;
+  *position++ = record->frameLength;
+  *position++ = record->battery;
+  *position++ = record->present;
+  position = OutputBinaryPut(position, (uint32_t)record->id, 4);
+  position = OutputBinaryPut(position, (uint32_t)record->channel, 4);
+  for(unsigned q = 0; q < QuantityCount; q++) {
+    position = OutputBinaryPut(position, (uint32_t)record->values[q], 4);
+  }
+  position = OutputBinaryPut(position, record->start, 8);
+  position = OutputBinaryPut(position, record->end, 8);
+  position = OutputBinaryPut(position, record->frame, 8);
+  memcpy(position, record->protocol->name, OutputBinaryLength(record->protocol->name, OUTPUT_BINARY_PROTOCOL));
+  position += OUTPUT_BINARY_PROTOCOL;
+  if(record->tag != NULL) {
+    memcpy(position, record->tag, OutputBinaryLength(record->tag, OUTPUT_BINARY_TAG));
+  }
+}
+
+/***********************************************************************************************************************
+ * Binary format: fixed size records, see OutputBinaryEncode()
+ **********************************************************************************************************************/
+static void OutputBinaryWrite(void *ctx, const OutputRecordType *record)
+{
+  OutputFileType *file = ctx;
+  uint8_t buffer[OUTPUT_BINARY_SIZE];
+
+  OutputBinaryEncode(record, buffer);
+  fwrite(buffer, sizeof(buffer), 1, file->stream);
+}
+
+/***********************************************************************************************************************
+ * Pass the batched readings on
+ **********************************************************************************************************************/
+static void OutputFileFlush(void *ctx)
+{
+  OutputFileType *file = ctx;
+
+  fflush(file->stream);
+}
+
+/***********************************************************************************************************************
+ * Close the file, standard output is only flushed
+ **********************************************************************************************************************/
+static void OutputFileClose(void *ctx)
+{
+  OutputFileType *file = ctx;
+
+  if(file->stream != stdout) {
+    fclose(file->stream);
+  }
+  else {
+    fflush(stdout);
+  }
+}
+
+// Output formats
+static const OutputFormatType outputFormats[] = {
+  { "text",   OutputTextWrite,   NULL },
+  { "json",   OutputJsonWrite,   NULL },
+  { "binary", OutputBinaryWrite, NULL },
+  { "shm",    NULL,              ShmRingSinkOpen }
+};
+
+/***********************************************************************************************************************
+ * Add sinks from a comma separated list of formats with optional file names: format[=file][,format[=file] ...].
+ * Without a file name or with "-", the format is written to standard output. Files are appended to. The shared memory
+ * ring takes the name of the ring instead of a file name.
+ **********************************************************************************************************************/
+bool OutputFormatConfig(const char *list)
+{
+  char copy[1024];
+  char *save = NULL;
+
+  if(strlen(list) >= sizeof(copy)) {
+    fprintf(stderr, "Output list too long: %s\n", list);
+    return false;
+  }
+  strcpy(copy, list);
+
+  for(char *entry = strtok_r(copy, ",", &save); entry != NULL; entry = strtok_r(NULL, ",", &save)) {
+    char *fileName = strchr(entry, '=');
+    const OutputFormatType *format = NULL;
+    OutputFileType *file;
+
+    if(fileName != NULL) {
+      *fileName++ = 0;
+    }
+    for(size_t f = 0; f < (sizeof(outputFormats) / sizeof(outputFormats[0])); f++) {
+      if(!strcmp(entry, outputFormats[f].name)) {
+        format = &outputFormats[f];
+        break;
+      }
+    }
+    if(format == NULL) {
+      fprintf(stderr, "Unknown output format: %s\n", entry);
+      return false;
+    }
+    if(format->open != NULL) {
+      if(!format->open(((fileName != NULL) && (*fileName != 0)) ? fileName : NULL)) {
+        return false;
+      }
+      continue;
+    }
+    if(outputFileCount >= OUTPUT_MAX_SINKS) {
+      fprintf(stderr, "Too many outputs (max. %u)\n", OUTPUT_MAX_SINKS);
+      return false;
+    }
+
+    file = &outputFiles[outputFileCount];
+    if((fileName == NULL) || (*fileName == 0) || !strcmp(fileName, "-")) {
+      file->stream = stdout;
+    }
+    else if((file->stream = fopen(fileName, "a")) == NULL) {
+      perror(fileName);
+      return false;
+    }
+    outputFileCount++;
+
+    OutputAddSink(&(OutputSinkType) {
+      .name = format->name, .write = format->write, .flush = OutputFileFlush, .close = OutputFileClose, .ctx = file
+    });
+  }
+
+  return true;
+}
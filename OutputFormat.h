@@ -0,0 +1,53 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef OUTPUTFORMAT_H_
+#define OUTPUTFORMAT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Output.h"
+
+// Longest text message
+#define OUTPUT_TEXT_LENGTH        256
+// Binary record: layout version and size in bytes
+#define OUTPUT_BINARY_VERSION     1
+#define OUTPUT_BINARY_SIZE        72
+// Room for the protocol name and the tag in a binary record (not terminated if they fill it)
+#define OUTPUT_BINARY_PROTOCOL    8
+#define OUTPUT_BINARY_TAG         16
+
+bool OutputFormatConfig(const char *list);
+void OutputBinaryEncode(const OutputRecordType *record, uint8_t *buffer);
+
+#endif // OUTPUTFORMAT_H_
@@ -0,0 +1,387 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "TimeStamp.h"
+#include "Pipeline.h"
+
+/***********************************************************************************************************************
+ * Wake up a thread waiting on an event file descriptor
+ **********************************************************************************************************************/
+static void PipelineWake(int fd)
+{
+  uint64_t wake = 1;
+
+  if(write(fd, &wake, sizeof(wake)) == -1) {
+    perror("eventfd");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/***********************************************************************************************************************
+ * Wait on an event file descriptor, returns early on signals
+ **********************************************************************************************************************/
+static void PipelineWait(int fd)
+{
+  uint64_t events;
+
+  if((read(fd, &events, sizeof(events)) == -1) && (errno != EINTR)) {
+    perror("eventfd");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/***********************************************************************************************************************
+ * Create an event file descriptor
+ **********************************************************************************************************************/
+static int PipelineEvent(void)
+{
+  int fd = eventfd(0, 0);
+
+  if(fd == -1) {
+    perror("eventfd()");
+    exit(EXIT_FAILURE);
+  }
+
+  return fd;
+}
+
+/***********************************************************************************************************************
+ * Reader thread: wait for any of the lirc devices with epoll and pass the samples with their arrival time to the
+ * decoder threads. It never blocks on them, batches that do not fit into a full ring are dropped.
+ **********************************************************************************************************************/
+static void *PipelineReader(void *arg)
+{
+  PipelineType *pipeline = arg;
+  struct epoll_event events[PIPELINE_MAX_RECEIVERS + 1];
+  struct epoll_event event = { .events = EPOLLIN, .data.u32 = PIPELINE_MAX_RECEIVERS };
+  int epollFd = epoll_create1(0);
+  unsigned active = pipeline->receiverCount;
+
+  if(epollFd == -1) {
+    perror("epoll_create1()");
+    exit(EXIT_FAILURE);
+  }
+  // The stop request has no receiver index
+  if(epoll_ctl(epollFd, EPOLL_CTL_ADD, pipeline->stopFd, &event) == -1) {
+    perror("epoll_ctl()");
+    exit(EXIT_FAILURE);
+  }
+  for(unsigned i = 0; i < pipeline->receiverCount; i++) {
+    event.data.u32 = i;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, pipeline->receivers[i].input->fd, &event) == -1) {
+      perror(pipeline->receivers[i].name);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  while(active > 0) {
+    int ready = epoll_wait(epollFd, events, PIPELINE_MAX_RECEIVERS + 1, -1);
+    if(ready == -1) {
+      if(errno != EINTR) {
+        perror("epoll_wait()");
+        exit(EXIT_FAILURE);
+      }
+      continue;
+    }
+
+    // Serve all receivers with data
+    for(int i = 0; i < ready; i++) {
+      unsigned index = events[i].data.u32;
+      PipelineReceiverType *rx;
+      const uint32_t *samples;
+      ssize_t count;
+
+      // Stop request
+      if(index >= PIPELINE_MAX_RECEIVERS) {
+        active = 0;
+        break;
+      }
+
+      rx = &pipeline->receivers[index];
+      count = PulseInputRead(rx->input, &samples);
+      if(count < 0) {
+        if(errno != EINTR) {
+          perror(rx->name);
+          exit(EXIT_FAILURE);
+        }
+      }
+      // End of file
+      else if(count == 0) {
+        fprintf(stderr, "%s: End of file\n", rx->name);
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, rx->input->fd, NULL);
+        active--;
+      }
+      else {
+        SampleRingPush(&pipeline->ring, index, TimeStampMonotonic() + pipeline->wallOffset, samples, count);
+      }
+    }
+
+    // Wake up the decoder threads
+    if(active == 0) {
+      atomic_store(&pipeline->finished, true);
+    }
+    for(unsigned w = 0; w < pipeline->workerCount; w++) {
+      PipelineWake(pipeline->workers[w].wakeFd);
+    }
+  }
+
+  close(epollFd);
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Decoder thread: decode every batch of the ring at the own read cursor
+ **********************************************************************************************************************/
+static void *PipelineDecoder(void *arg)
+{
+  PipelineWorkerType *worker = arg;
+  PipelineType *pipeline = worker->pipeline;
+  unsigned long done = 0;
+
+  for(;;) {
+    const SampleBatchType *batch = SampleRingFront(&pipeline->ring, worker->index);
+
+    // Caught up: let the output stage release the messages, then wait for new batches
+    if(batch == NULL) {
+      PipelineWake(pipeline->outputFd);
+      // The reader may have added batches right before finishing
+      if(atomic_load(&pipeline->finished) && (SampleRingFront(&pipeline->ring, worker->index) == NULL)) {
+        break;
+      }
+      PipelineWait(worker->wakeFd);
+      continue;
+    }
+
+    // The first decoder thread records, there is only one receiver then
+    if((worker->index == 0) && (pipeline->recorder != NULL) &&
+       !PulseArchiveWriterWrite(pipeline->recorder, batch->samples, batch->count)) {
+      perror("archive");
+      exit(EXIT_FAILURE);
+    }
+
+    // Messages are merged in batch order
+    worker->queue.sequence = done;
+    if(worker->protocols != 0) {
+      DecoderContext *decoder = worker->decoders[batch->receiver];
+
+      // The first batch starts the pulse clock, later ones correct its drift. All threads see the same batches, so
+      // their clocks agree.
+      TimeStampAnchor(&decoder->clock, batch->time, DecoderDuration(batch->samples, batch->count));
+      DecoderProcess(decoder, batch->samples, batch->count);
+    }
+    SampleRingPop(&pipeline->ring, worker->index);
+    atomic_store_explicit(&worker->done, ++done, memory_order_release);
+  }
+
+  atomic_store(&worker->exited, true);
+  PipelineWake(pipeline->outputFd);
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Print all messages no decoder thread can precede any more, in the order a single decoder would have printed them:
+ * by batch, then by time stamp
+ **********************************************************************************************************************/
+static void PipelineMerge(PipelineType *pipeline)
+{
+  for(;;) {
+    const OutputMessageType *heads[DECODER_MAX_THREADS];
+    unsigned long done[DECODER_MAX_THREADS];
+    const OutputMessageType *first = NULL;
+    unsigned firstWorker = 0;
+
+    // Progress has to be read before the queue, messages are queued before the progress is published
+    for(unsigned w = 0; w < pipeline->workerCount; w++) {
+      done[w] = atomic_load_explicit(&pipeline->workers[w].done, memory_order_acquire);
+      heads[w] = OutputQueueFront(&pipeline->workers[w].queue);
+      if((heads[w] != NULL) && ((first == NULL) || (heads[w]->sequence < first->sequence) ||
+         ((heads[w]->sequence == first->sequence) && (heads[w]->record.end < first->record.end)))) {
+        first = heads[w];
+        firstWorker = w;
+      }
+    }
+    if(first == NULL) {
+      break;
+    }
+
+    // Threads without queued messages may still be decoding the batch
+    for(unsigned w = 0; w < pipeline->workerCount; w++) {
+      if((heads[w] == NULL) && (done[w] <= first->sequence)) {
+        return;
+      }
+    }
+
+    OutputDeliver(&first->record);
+    OutputQueuePop(&pipeline->workers[firstWorker].queue);
+  }
+}
+
+/***********************************************************************************************************************
+ * Set up the decoders and start the threads. Signals are handled by the calling thread only.
+ **********************************************************************************************************************/
+void PipelineStart(PipelineType *pipeline, const PipelineReceiverType *receivers, unsigned count,
+  const DecoderConfigType *config, PulseArchiveWriter *recorder)
+{
+  sigset_t all, previous;
+  int error = 0;
+
+  memcpy(pipeline->receivers, receivers, count * sizeof(receivers[0]));
+  pipeline->receiverCount = count;
+  pipeline->recorder = recorder;
+  pipeline->wallOffset = TimeStampWallOffset();
+  pipeline->outputFd = PipelineEvent();
+  pipeline->stopFd = PipelineEvent();
+  atomic_init(&pipeline->finished, false);
+  pipeline->startTime = TimeStampMonotonic();
+
+  // Decoder threads with their share of the protocols, the first one is needed for recording
+  pipeline->workerCount = 0;
+  for(unsigned t = 0; t < config->threads; t++) {
+    PipelineWorkerType *worker = &pipeline->workers[pipeline->workerCount];
+    DecoderConfigType share = *config;
+    OutputTargetType target = { .queue = &worker->queue, .list = NULL };
+
+    share.protocols = DecoderThreadProtocols(config, t);
+    if((share.protocols == 0) && ((pipeline->workerCount > 0) || (recorder == NULL))) {
+      continue;
+    }
+    worker->pipeline = pipeline;
+    worker->index = pipeline->workerCount++;
+    worker->number = t;
+    worker->protocols = share.protocols;
+    worker->wakeFd = PipelineEvent();
+    atomic_init(&worker->done, 0);
+    atomic_init(&worker->exited, false);
+    OutputQueueInit(&worker->queue, pipeline->outputFd);
+    for(unsigned r = 0; r < count; r++) {
+      worker->decoders[r] = calloc(1, sizeof(DecoderContext));
+      if(worker->decoders[r] == NULL) {
+        perror("calloc()");
+        exit(EXIT_FAILURE);
+      }
+      DecoderInit(worker->decoders[r], receivers[r].tag, TimeStampRealTime, &share, &target);
+    }
+  }
+  SampleRingInit(&pipeline->ring, pipeline->workerCount);
+
+  // The threads inherit the blocked signals
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &previous);
+  for(unsigned w = 0; (w < pipeline->workerCount) && (error == 0); w++) {
+    error = pthread_create(&pipeline->workers[w].thread, NULL, PipelineDecoder, &pipeline->workers[w]);
+  }
+  if(error == 0) {
+    error = pthread_create(&pipeline->reader, NULL, PipelineReader, pipeline);
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  if(error != 0) {
+    errno = error;
+    perror("pthread_create()");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/***********************************************************************************************************************
+ * Output stage: wait for decoded messages and print them in order.
+ * Returns false once all decoder threads finished.
+ **********************************************************************************************************************/
+bool PipelineService(PipelineType *pipeline)
+{
+  bool running = false;
+
+  PipelineWait(pipeline->outputFd);
+  PipelineMerge(pipeline);
+
+  for(unsigned w = 0; w < pipeline->workerCount; w++) {
+    if(!atomic_load(&pipeline->workers[w].exited)) {
+      running = true;
+    }
+  }
+
+  return running;
+}
+
+/***********************************************************************************************************************
+ * Stop reading, let the decoder threads finish the batches read so far and print their messages
+ **********************************************************************************************************************/
+void PipelineStop(PipelineType *pipeline)
+{
+  PipelineWake(pipeline->stopFd);
+  pthread_join(pipeline->reader, NULL);
+  for(unsigned w = 0; w < pipeline->workerCount; w++) {
+    pthread_join(pipeline->workers[w].thread, NULL);
+  }
+  PipelineMerge(pipeline);
+
+  for(unsigned w = 0; w < pipeline->workerCount; w++) {
+    for(unsigned r = 0; r < pipeline->receiverCount; r++) {
+      DecoderFree(pipeline->workers[w].decoders[r]);
+      free(pipeline->workers[w].decoders[r]);
+    }
+    close(pipeline->workers[w].wakeFd);
+  }
+  close(pipeline->outputFd);
+  close(pipeline->stopFd);
+}
+
+/***********************************************************************************************************************
+ * Print statistics of the ring and the utilization of the decoder threads
+ **********************************************************************************************************************/
+void PipelinePrintStatistics(PipelineType *pipeline, FILE *stream)
+{
+  double elapsed = (TimeStampMonotonic() - pipeline->startTime) / 1e6;
+
+  SampleRingPrintStatistics(&pipeline->ring, stream);
+  for(unsigned w = 0; w < pipeline->workerCount; w++) {
+    PipelineWorkerType *worker = &pipeline->workers[w];
+    struct timespec cpu = { 0, 0 };
+    clockid_t clock;
+
+    // Processor time of the thread
+    if(pthread_getcpuclockid(worker->thread, &clock) == 0) {
+      clock_gettime(clock, &cpu);
+    }
+    fprintf(stream, "decoder thread %u: %d protocols, %lu batches, %.1f%% busy\n", worker->number,
+      __builtin_popcount(worker->protocols),
+      atomic_load(&worker->done), (elapsed > 0) ? ((cpu.tv_sec + (cpu.tv_nsec / 1e9)) * 100 / elapsed) : 0.0);
+  }
+  fflush(stream);
+}
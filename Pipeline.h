@@ -0,0 +1,117 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "PulseInput.h"
+#include "PulseArchive.h"
+#include "Decoder.h"
+#include "Output.h"
+#include "SampleRing.h"
+
+// Maximum number of receivers of a pipeline
+#define PIPELINE_MAX_RECEIVERS    8
+
+// Receiver fed into the pipeline
+typedef struct {
+  // Device file name
+  const char *name;
+  // Tag printed in front of the decoded messages (NULL: no tag)
+  const char *tag;
+  // Input
+  PulseInputContext *input;
+} PipelineReceiverType;
+
+struct PipelineStruct;
+
+// Decoder thread: decodes the samples of all receivers with its share of the protocols
+typedef struct {
+  struct PipelineStruct *pipeline;
+  // Index of the thread, read cursor in the sample ring
+  unsigned index;
+  // Thread number in the configuration
+  unsigned number;
+  // Protocols decoded by the thread
+  uint32_t protocols;
+  // Decoders, one per receiver
+  DecoderContext *decoders[PIPELINE_MAX_RECEIVERS];
+  // Messages to the output stage
+  OutputQueueType queue;
+  // Wakes up the thread after new batches
+  int wakeFd;
+  // Number of batches completely decoded, all messages of earlier batches are queued
+  _Alignas(64) atomic_ulong done;
+  // Thread finished
+  atomic_bool exited;
+  pthread_t thread;
+} PipelineWorkerType;
+
+// Live decoding pipeline: a reader thread passes the samples through a broadcast ring to the decoder threads, their
+// messages are merged back in order by the output stage running in the calling thread
+typedef struct PipelineStruct {
+  // Receivers
+  PipelineReceiverType receivers[PIPELINE_MAX_RECEIVERS];
+  unsigned receiverCount;
+  // Samples of all receivers
+  SampleRingType ring;
+  // Decoder threads
+  PipelineWorkerType workers[DECODER_MAX_THREADS];
+  unsigned workerCount;
+  // Optional recorder, fed by the first decoder thread
+  PulseArchiveWriter *recorder;
+  // Offset from the monotonic clock to the wall clock in us
+  int64_t wallOffset;
+  // Wakes up the output stage
+  int outputFd;
+  // Stop request to the reader thread
+  int stopFd;
+  // Reader thread finished, no more batches
+  atomic_bool finished;
+  pthread_t reader;
+  // Start time for the utilization statistics
+  uint64_t startTime;
+} PipelineType;
+
+void PipelineStart(PipelineType *pipeline, const PipelineReceiverType *receivers, unsigned count,
+  const DecoderConfigType *config, PulseArchiveWriter *recorder);
+bool PipelineService(PipelineType *pipeline);
+void PipelineStop(PipelineType *pipeline);
+void PipelinePrintStatistics(PipelineType *pipeline, FILE *stream);
+
+#endif // PIPELINE_H_
@@ -0,0 +1,104 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "types.h"
+#include "Dedup.h"
+#include "Output.h"
+#include "FrameAssembler.h"
+
+// Timing profiles
+typedef enum {
+  // Signal directly from the receiver
+  TimingDigital,
+  // Signal coming through the analog filter
+  TimingAnalog,
+  // Number of profiles
+  TimingProfileCount
+} TimingProfileType;
+
+// Bit decoder description
+typedef struct {
+  // Size of the decoder context
+  size_t contextSize;
+  // Size of the timing parameters
+  size_t timingSize;
+  // Initialize decoder context with timing parameters
+  void (*init)(void *ctx, const void *timing);
+  // Decode a pulse into a bit
+  BitType (*decode)(void *ctx, const PulseType *pulse);
+} BitDecoderType;
+
+// Environment shared by the protocols of a decoder context
+typedef struct {
+  // Output tag
+  const char *tag;
+  // Duplicate filter
+  DedupTable *dedup;
+  // Destination of the messages
+  OutputTargetType output;
+} ProtocolEnvironmentType;
+
+// Protocol description
+typedef struct ProtocolStruct {
+  // Protocol name
+  const char *name;
+  // Bit decoder and its timing parameters per profile. Protocols with the same bit decoder and timing share one bit
+  // decoder.
+  const BitDecoderType *bitDecoder;
+  const void *timing[TimingProfileCount];
+  // Size of the protocol context
+  size_t contextSize;
+  // Initialize protocol context with the confirmation policy of its messages
+  void (*init)(void *ctx, const ProtocolEnvironmentType *environment, DedupPolicyType confirm);
+  // Parse a complete frame, the first received bit is the MSB. Streams are cut into frames of frameLength bits, up to
+  // frameLengthMax - frameLength trailing bits behind the last one are ignored. Longer frames are cut to their first
+  // frameLength bits. Returns true if the frame is valid for the protocol.
+  bool (*parse)(void *ctx, const FrameType *frame);
+  uint8_t frameLength;
+  uint8_t frameLengthMax;
+  // Sync word searched at every bit (preamble of a protocol with a checksum). Protocols with one also get every
+  // frameLength bits behind other bits of a stream that start with the sync word.
+  uint8_t syncLength;
+  uint32_t sync;
+  // Default confirmation policy
+  DedupPolicyType confirm;
+  // Print a reading of the protocol in its own text format (protocol name and fields, terminated by a newline)
+  int (*format)(const OutputRecordType *record, char *text, size_t size);
+} ProtocolType;
+
+#endif // PROTOCOL_H_
@@ -0,0 +1,511 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "types.h"
+#include "PulseArchive.h"
+
+// Magic numbers
+#define FILE_MAGIC      0x41585257  // "WRXA"
+#define BLOCK_MAGIC     0x4B4C4257  // "WBLK"
+#define INDEX_MAGIC     0x49585257  // "WRXI"
+// Format version
+#define FILE_VERSION    1
+
+// Stored sizes of the file header, block header, index entry and trailer
+#define FILE_HEADER_SIZE    12
+#define BLOCK_HEADER_SIZE   24
+#define INDEX_ENTRY_SIZE    24
+#define TRAILER_SIZE        16
+
+/***********************************************************************************************************************
+ * Store value little endian in size bytes
+ **********************************************************************************************************************/
+static uint8_t *PulseArchivePut(uint8_t *buffer, uint64_t value, unsigned size)
+{
+  for(unsigned i = 0; i < size; i++) {
+    *buffer++ = value >> (i * 8);
+  }
+
+  return buffer;
+}
+
+/***********************************************************************************************************************
+ * Load little endian value of size bytes and advance the buffer
+ **********************************************************************************************************************/
+static uint64_t PulseArchiveGet(const uint8_t **buffer, unsigned size)
+{
+  uint64_t value = 0;
+
+  for(unsigned i = 0; i < size; i++) {
+    value |= (uint64_t)*(*buffer)++ << (i * 8);
+  }
+
+  return value;
+}
+
+/***********************************************************************************************************************
+ * Store / load block header
+ **********************************************************************************************************************/
+static void PulseArchivePutBlockHeader(uint8_t *buffer, const PulseArchiveBlockHeader *block)
+{
+  buffer = PulseArchivePut(buffer, block->magic, 4);
+  buffer = PulseArchivePut(buffer, block->length, 4);
+  buffer = PulseArchivePut(buffer, block->samples, 4);
+  buffer = PulseArchivePut(buffer, block->reserved, 4);
+  PulseArchivePut(buffer, block->time, 8);
+}
+
+static void PulseArchiveGetBlockHeader(const uint8_t *buffer, PulseArchiveBlockHeader *block)
+{
+  block->magic = PulseArchiveGet(&buffer, 4);
+  block->length = PulseArchiveGet(&buffer, 4);
+  block->samples = PulseArchiveGet(&buffer, 4);
+  block->reserved = PulseArchiveGet(&buffer, 4);
+  block->time = PulseArchiveGet(&buffer, 8);
+}
+
+/***********************************************************************************************************************
+ * Store / load block index entry
+ **********************************************************************************************************************/
+static void PulseArchivePutIndexEntry(uint8_t *buffer, const PulseArchiveIndexEntry *entry)
+{
+  buffer = PulseArchivePut(buffer, entry->time, 8);
+  buffer = PulseArchivePut(buffer, entry->offset, 8);
+  buffer = PulseArchivePut(buffer, entry->samples, 4);
+  PulseArchivePut(buffer, entry->reserved, 4);
+}
+
+static void PulseArchiveGetIndexEntry(const uint8_t *buffer, PulseArchiveIndexEntry *entry)
+{
+  entry->time = PulseArchiveGet(&buffer, 8);
+  entry->offset = PulseArchiveGet(&buffer, 8);
+  entry->samples = PulseArchiveGet(&buffer, 4);
+  entry->reserved = PulseArchiveGet(&buffer, 4);
+}
+
+/***********************************************************************************************************************
+ * Get wall clock in us
+ **********************************************************************************************************************/
+static uint64_t PulseArchiveGetTime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/***********************************************************************************************************************
+ * Write the actual block with its header and record it in the index
+ **********************************************************************************************************************/
+static bool PulseArchiveWriterFlush(PulseArchiveWriter *ctx)
+{
+  uint8_t header[BLOCK_HEADER_SIZE];
+
+  // Nothing to do on empty block
+  if(ctx->block.samples == 0) {
+    return true;
+  }
+
+  // Grow index if needed
+  if(ctx->indexEntries >= ctx->indexSize) {
+    uint32_t size = ctx->indexSize ? (ctx->indexSize * 2) : 256;
+    PulseArchiveIndexEntry *index = realloc(ctx->index, size * sizeof(PulseArchiveIndexEntry));
+    if(index == NULL) {
+      return false;
+    }
+    ctx->index = index;
+    ctx->indexSize = size;
+  }
+  ctx->index[ctx->indexEntries++] = (PulseArchiveIndexEntry) {
+    .time = ctx->block.time,
+    .offset = ctx->offset,
+    .samples = ctx->block.samples
+  };
+
+  // Write block
+  PulseArchivePutBlockHeader(header, &ctx->block);
+  if((fwrite(header, sizeof(header), 1, ctx->file) != 1) ||
+     (fwrite(ctx->payload, ctx->block.length, 1, ctx->file) != 1)) {
+    return false;
+  }
+  ctx->offset += sizeof(header) + ctx->block.length;
+
+  // Start a new block
+  ctx->block.samples = 0;
+  ctx->block.length = 0;
+
+  return fflush(ctx->file) == 0;
+}
+
+/***********************************************************************************************************************
+ * Create archive file
+ **********************************************************************************************************************/
+bool PulseArchiveWriterOpen(PulseArchiveWriter *ctx, const char *name, bool pulseClock)
+{
+  uint8_t header[FILE_HEADER_SIZE] = { 0 };
+  uint8_t *position = header;
+
+  position = PulseArchivePut(position, FILE_MAGIC, 4);
+  position = PulseArchivePut(position, FILE_VERSION, 2);
+  PulseArchivePut(position, PULSE_ARCHIVE_QUANTUM, 2);
+
+  memset(ctx, 0, sizeof(PulseArchiveWriter));
+  ctx->block.magic = BLOCK_MAGIC;
+  ctx->pulseClock = pulseClock;
+
+  ctx->file = fopen(name, "wb");
+  if(ctx->file == NULL) {
+    return false;
+  }
+
+  if(fwrite(&header, sizeof(header), 1, ctx->file) != 1) {
+    return false;
+  }
+  ctx->offset = sizeof(header);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Append samples to the archive
+ **********************************************************************************************************************/
+bool PulseArchiveWriterWrite(PulseArchiveWriter *ctx, const uint32_t *samples, size_t count)
+{
+  uint64_t now = ctx->pulseClock ? ctx->pulseTime : PulseArchiveGetTime();
+
+  // Close the actual block if its sync point is too old
+  if((ctx->block.samples > 0) && ((now - ctx->block.time) >= PULSE_ARCHIVE_BLOCK_TIME)) {
+    if(!PulseArchiveWriterFlush(ctx)) {
+      return false;
+    }
+  }
+
+  for(size_t i = 0; i < count; i++) {
+    // Carrier frequency reports are no pulses, as a space they would break the stream on replay
+    if((samples[i] & LIRC_MODE2_MASK) == LIRC_MODE2_FREQUENCY) {
+      continue;
+    }
+
+    // Polarity and quantized length
+    uint32_t pulse = ((samples[i] & LIRC_MODE2_MASK) == LIRC_MODE2_PULSE) ? 1 : 0;
+    uint32_t length = ((samples[i] & LIRC_VALUE_MASK) + (PULSE_ARCHIVE_QUANTUM / 2)) / PULSE_ARCHIVE_QUANTUM;
+    int32_t delta;
+    uint32_t code;
+
+    // Start a new block with a sync point
+    if(ctx->block.samples == 0) {
+      ctx->block.time = ctx->pulseClock ? ctx->pulseTime : now;
+      ctx->previous[0] = ctx->previous[1] = 0;
+    }
+    ctx->pulseTime += samples[i] & LIRC_VALUE_MASK;
+
+    // Zig-zag coded delta to the previous sample of the same polarity, polarity as LSB
+    delta = length - ctx->previous[pulse];
+    ctx->previous[pulse] = length;
+    code = ((((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31)) << 1) | pulse;
+
+    // LEB128 varint
+    while(code >= 0x80) {
+      ctx->payload[ctx->block.length++] = (code & 0x7F) | 0x80;
+      code >>= 7;
+    }
+    ctx->payload[ctx->block.length++] = code;
+
+    ctx->samples++;
+    if(++ctx->block.samples >= PULSE_ARCHIVE_BLOCK_SAMPLES) {
+      if(!PulseArchiveWriterFlush(ctx)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Write the last block and the block index and close the archive
+ **********************************************************************************************************************/
+bool PulseArchiveWriterClose(PulseArchiveWriter *ctx)
+{
+  uint8_t buffer[INDEX_ENTRY_SIZE];
+  uint8_t trailer[TRAILER_SIZE];
+  uint8_t *position = trailer;
+  bool ok = PulseArchiveWriterFlush(ctx);
+
+  position = PulseArchivePut(position, ctx->offset, 8);
+  position = PulseArchivePut(position, ctx->indexEntries, 4);
+  PulseArchivePut(position, INDEX_MAGIC, 4);
+
+  for(uint32_t i = 0; ok && (i < ctx->indexEntries); i++) {
+    PulseArchivePutIndexEntry(buffer, &ctx->index[i]);
+    ok = (fwrite(buffer, sizeof(buffer), 1, ctx->file) == 1);
+  }
+  if(ok) {
+    ok = (fwrite(trailer, sizeof(trailer), 1, ctx->file) == 1);
+  }
+
+  if(fclose(ctx->file) != 0) {
+    ok = false;
+  }
+  ctx->file = NULL;
+
+  fprintf(stderr, "archive: %llu samples in %llu bytes, %.2f bytes/sample\n", (unsigned long long)ctx->samples,
+    (unsigned long long)(ctx->offset + (ctx->indexEntries * INDEX_ENTRY_SIZE) + sizeof(trailer)),
+    ctx->samples ? (double)ctx->offset / ctx->samples : 0.0);
+
+  free(ctx->index);
+  ctx->index = NULL;
+
+  return ok;
+}
+
+/***********************************************************************************************************************
+ * Build the block index by walking through the blocks (archive without index)
+ **********************************************************************************************************************/
+static bool PulseArchiveReaderScan(PulseArchiveReader *ctx)
+{
+  uint64_t offset = FILE_HEADER_SIZE;
+  uint32_t size = 0;
+
+  while((offset + BLOCK_HEADER_SIZE) <= ctx->mapSize) {
+    PulseArchiveBlockHeader block;
+    PulseArchiveGetBlockHeader(ctx->map + offset, &block);
+
+    // Stop at the first incomplete or invalid block
+    if((block.magic != BLOCK_MAGIC) || ((offset + BLOCK_HEADER_SIZE + block.length) > ctx->mapSize)) {
+      break;
+    }
+
+    if(ctx->indexEntries >= size) {
+      size = size ? (size * 2) : 256;
+      PulseArchiveIndexEntry *index = realloc(ctx->index, size * sizeof(PulseArchiveIndexEntry));
+      if(index == NULL) {
+        return false;
+      }
+      ctx->index = index;
+    }
+    ctx->index[ctx->indexEntries++] = (PulseArchiveIndexEntry) {
+      .time = block.time,
+      .offset = offset,
+      .samples = block.samples
+    };
+
+    offset += BLOCK_HEADER_SIZE + block.length;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Open archive for reading
+ **********************************************************************************************************************/
+bool PulseArchiveReaderOpen(PulseArchiveReader *ctx, const char *name)
+{
+  const uint8_t *position;
+  uint64_t indexOffset = 0;
+  uint32_t indexEntries = 0, magic = 0;
+  uint16_t version, quantum;
+  struct stat st;
+  void *map;
+  int fd;
+
+  memset(ctx, 0, sizeof(PulseArchiveReader));
+
+  fd = open(name, O_RDONLY);
+  if(fd == -1) {
+    return false;
+  }
+  if((fstat(fd, &st) == -1) || (st.st_size < FILE_HEADER_SIZE)) {
+    close(fd);
+    return false;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    return false;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  ctx->map = map;
+  ctx->mapSize = st.st_size;
+
+  // Check header
+  position = ctx->map;
+  magic = PulseArchiveGet(&position, 4);
+  version = PulseArchiveGet(&position, 2);
+  quantum = PulseArchiveGet(&position, 2);
+  if((magic != FILE_MAGIC) || (version != FILE_VERSION) || (quantum == 0)) {
+    PulseArchiveReaderClose(ctx);
+    return false;
+  }
+  ctx->quantum = quantum;
+
+  // Use stored index if present and sane, otherwise scan blocks
+  magic = 0;
+  if(ctx->mapSize >= (FILE_HEADER_SIZE + TRAILER_SIZE)) {
+    position = ctx->map + ctx->mapSize - TRAILER_SIZE;
+    indexOffset = PulseArchiveGet(&position, 8);
+    indexEntries = PulseArchiveGet(&position, 4);
+    magic = PulseArchiveGet(&position, 4);
+  }
+  if((magic == INDEX_MAGIC) &&
+     ((indexOffset + ((uint64_t)indexEntries * INDEX_ENTRY_SIZE) + TRAILER_SIZE) == ctx->mapSize)) {
+    // One spare entry, so that an empty index is no allocation failure
+    ctx->index = malloc(((size_t)indexEntries + 1) * sizeof(PulseArchiveIndexEntry));
+    if(ctx->index == NULL) {
+      PulseArchiveReaderClose(ctx);
+      return false;
+    }
+    for(uint32_t i = 0; i < indexEntries; i++) {
+      PulseArchiveGetIndexEntry(ctx->map + indexOffset + ((uint64_t)i * INDEX_ENTRY_SIZE), &ctx->index[i]);
+    }
+    ctx->indexEntries = indexEntries;
+  }
+  else if(!PulseArchiveReaderScan(ctx)) {
+    PulseArchiveReaderClose(ctx);
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Position the reader to the last block starting at or before the given wall clock time in us
+ **********************************************************************************************************************/
+bool PulseArchiveReaderSeek(PulseArchiveReader *ctx, uint64_t time)
+{
+  uint32_t low = 0, high = ctx->indexEntries;
+
+  // Binary search for the first block after time
+  while(low < high) {
+    uint32_t mid = (low + high) / 2;
+    if(ctx->index[mid].time <= time) {
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+
+  ctx->blockNr = (low > 0) ? (low - 1) : 0;
+  ctx->samplesLeft = 0;
+  ctx->position = NULL;
+
+  return ctx->blockNr < ctx->indexEntries;
+}
+
+/***********************************************************************************************************************
+ * Decode up to count samples (never crossing a block boundary). If the samples start a new block, syncTime is set to
+ * the wall clock time of the block in us, otherwise to 0.
+ * Returns the number of samples, 0 at the end of the archive and -1 on a corrupt archive.
+ **********************************************************************************************************************/
+ssize_t PulseArchiveReaderRead(PulseArchiveReader *ctx, uint32_t *samples, size_t count, uint64_t *syncTime)
+{
+  size_t n;
+
+  *syncTime = 0;
+
+  // Enter next block
+  if(ctx->samplesLeft == 0) {
+    PulseArchiveBlockHeader block;
+
+    if(ctx->position != NULL) {
+      ctx->blockNr++;
+    }
+    if(ctx->blockNr >= ctx->indexEntries) {
+      return 0;
+    }
+
+    if((ctx->index[ctx->blockNr].offset + BLOCK_HEADER_SIZE) > ctx->mapSize) {
+      return -1;
+    }
+    PulseArchiveGetBlockHeader(ctx->map + ctx->index[ctx->blockNr].offset, &block);
+    ctx->position = ctx->map + ctx->index[ctx->blockNr].offset + BLOCK_HEADER_SIZE;
+    ctx->end = ctx->position + block.length;
+    if((block.magic != BLOCK_MAGIC) || (ctx->end > (ctx->map + ctx->mapSize))) {
+      return -1;
+    }
+    ctx->samplesLeft = block.samples;
+    ctx->previous[0] = ctx->previous[1] = 0;
+    *syncTime = block.time;
+  }
+
+  if(count > ctx->samplesLeft) {
+    count = ctx->samplesLeft;
+  }
+
+  for(n = 0; n < count; n++) {
+    uint32_t code = 0, pulse, length;
+    uint8_t shift = 0;
+    int32_t delta;
+
+    // LEB128 varint
+    do {
+      if((ctx->position >= ctx->end) || (shift > 28)) {
+        return -1;
+      }
+      code |= (uint32_t)(*ctx->position & 0x7F) << shift;
+      shift += 7;
+    } while(*(ctx->position++) & 0x80);
+
+    // Polarity and zig-zag coded delta
+    pulse = code & 1;
+    code >>= 1;
+    delta = (int32_t)(code >> 1) ^ -(int32_t)(code & 1);
+    length = ctx->previous[pulse] + delta;
+    ctx->previous[pulse] = length;
+
+    samples[n] = ((length * ctx->quantum) & LIRC_VALUE_MASK) | (pulse ? LIRC_MODE2_PULSE : LIRC_MODE2_SPACE);
+  }
+  ctx->samplesLeft -= count;
+
+  return count;
+}
+
+/***********************************************************************************************************************
+ * Close archive reader
+ **********************************************************************************************************************/
+void PulseArchiveReaderClose(PulseArchiveReader *ctx)
+{
+  if(ctx->map != NULL) {
+    munmap((void *)ctx->map, ctx->mapSize);
+    ctx->map = NULL;
+  }
+  free(ctx->index);
+  ctx->index = NULL;
+}
@@ -0,0 +1,129 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef PULSE_ARCHIVE_H_
+#define PULSE_ARCHIVE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * Compact raw pulse archive
+ *
+ * File layout (all values little endian):
+ *   File header   "WRXA", version (u16), quantum in us (u16), reserved (u32)
+ *   Blocks        block header: "WBLK", payload length (u32), samples (u32), reserved (u32), sync time in us (u64)
+ *                 + varint coded samples
+ *   Block index   one entry per block: sync time in us (u64), file offset (u64), samples (u32), reserved (u32)
+ *   Trailer       index offset (u64), number of index entries (u32), "WRXI"
+ *
+ * Every block starts with a wall clock sync point and can be decoded on its own. Samples are quantized to the
+ * archive quantum, and coded as the zig-zag delta to the previous sample of the same polarity with the pulse / space
+ * bit as LSB into a LEB128 varint. Archives without index (recorder not closed properly) are scanned block by block.
+ * Receiver timeouts are stored as spaces, their length still ends the frames on replay.
+ */
+
+// Quantization of pulse lengths in us
+#define PULSE_ARCHIVE_QUANTUM         10
+// Maximum number of samples in a block
+#define PULSE_ARCHIVE_BLOCK_SAMPLES   4096
+// Maximum time span of a block in us (sync point interval)
+#define PULSE_ARCHIVE_BLOCK_TIME      (10 * 1000000ULL)
+
+// Block header (in memory, see the file layout for the stored form)
+typedef struct {
+  uint32_t magic;
+  uint32_t length;
+  uint32_t samples;
+  uint32_t reserved;
+  uint64_t time;
+} PulseArchiveBlockHeader;
+
+// Block index entry (in memory, see the file layout for the stored form)
+typedef struct {
+  uint64_t time;
+  uint64_t offset;
+  uint32_t samples;
+  uint32_t reserved;
+} PulseArchiveIndexEntry;
+
+// Archive recorder context
+typedef struct {
+  FILE *file;
+  // Actual block
+  PulseArchiveBlockHeader block;
+  uint8_t payload[PULSE_ARCHIVE_BLOCK_SAMPLES * 5];
+  // Previous quantized length for spaces and pulses
+  uint32_t previous[2];
+  // Derive sync points from the written pulse lengths instead of the wall clock (recording a replay)
+  bool pulseClock;
+  uint64_t pulseTime;
+  // Current file offset
+  uint64_t offset;
+  // Block index
+  PulseArchiveIndexEntry *index;
+  uint32_t indexEntries;
+  uint32_t indexSize;
+  // Statistics
+  uint64_t samples;
+} PulseArchiveWriter;
+
+// Archive reader context
+typedef struct {
+  // Memory mapped archive
+  const uint8_t *map;
+  size_t mapSize;
+  uint16_t quantum;
+  // Block index (loaded from the archive or built by scanning the blocks)
+  PulseArchiveIndexEntry *index;
+  uint32_t indexEntries;
+  // Actual block
+  uint32_t blockNr;
+  const uint8_t *position;
+  const uint8_t *end;
+  uint32_t samplesLeft;
+  uint32_t previous[2];
+} PulseArchiveReader;
+
+bool PulseArchiveWriterOpen(PulseArchiveWriter *ctx, const char *name, bool pulseClock);
+bool PulseArchiveWriterWrite(PulseArchiveWriter *ctx, const uint32_t *samples, size_t count);
+bool PulseArchiveWriterClose(PulseArchiveWriter *ctx);
+
+bool PulseArchiveReaderOpen(PulseArchiveReader *ctx, const char *name);
+bool PulseArchiveReaderSeek(PulseArchiveReader *ctx, uint64_t time);
+ssize_t PulseArchiveReaderRead(PulseArchiveReader *ctx, uint32_t *samples, size_t count, uint64_t *syncTime);
+void PulseArchiveReaderClose(PulseArchiveReader *ctx);
+
+#endif // PULSE_ARCHIVE_H_
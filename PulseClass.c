@@ -0,0 +1,336 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "PulseClass.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PULSE_CLASS_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PULSE_CLASS_NEON
+#endif
+
+// Maximum number of distinct length windows
+#define MAX_CLASSES  (sizeof(PulseClassType) * 8)
+
+// Classification table
+PulseClassType pulseClassTable[PULSE_CLASS_TABLE_SIZE];
+PulseClassType pulseClassPartial[PULSE_CLASS_TABLE_SIZE];
+
+// Registered length windows
+static struct {
+  uint32_t min;
+  uint32_t max;
+} classWindows[MAX_CLASSES];
+static uint8_t classCount = 0;
+
+// Registered windows as exclusive limits for the window compare kernels: a length matches if it is greater than
+// lowLength and less than highLength
+static int32_t lowLength[MAX_CLASSES];
+static int32_t highLength[MAX_CLASSES];
+
+// Batch classification kernel
+typedef struct {
+  // Name printed by the benchmark
+  const char *name;
+  // Instruction set available on this CPU
+  bool (*supported)(void);
+  // Classify count raw lirc samples
+  void (*classify)(const uint32_t *samples, size_t count, PulseClassType *classes);
+  // Selected automatically. The window compare kernels do work for every registered class and are slower than the
+  // scalar table lookup with the usual number of classes, they are only benchmarked.
+  bool automatic;
+} PulseClassKernelType;
+
+static void PulseClassifyScalar(const uint32_t *samples, size_t count, PulseClassType *classes);
+static void PulseClassSelectKernel(void);
+
+// Kernel selected for this CPU
+static void (*classifyBatch)(const uint32_t *samples, size_t count, PulseClassType *classes) = PulseClassifyScalar;
+
+/***********************************************************************************************************************
+ * Register a pulse length window [min .. max] and return its class bit. Decoders using the same window share the same
+ * class. Must be called before decoding starts.
+ **********************************************************************************************************************/
+PulseClassType PulseClassAdd(uint32_t min, uint32_t max)
+{
+  PulseClassType class;
+  uint32_t i;
+
+  // Already registered?
+  for(i = 0; i < classCount; i++) {
+    if((classWindows[i].min == min) && (classWindows[i].max == max)) {
+      return (PulseClassType)1 << i;
+    }
+  }
+
+  // Window must fit into the table and we must have a free class
+  if(((max != PULSE_CLASS_UNLIMITED) && (max > PULSE_CLASS_MAX_LENGTH)) || (classCount >= MAX_CLASSES)) {
+    fprintf(stderr, "Cannot classify pulse length window %u .. %u\n", min, max);
+    exit(EXIT_FAILURE);
+  }
+
+  classWindows[classCount].min = min;
+  classWindows[classCount].max = max;
+  class = (PulseClassType)1 << classCount;
+  classCount++;
+
+  // Sample lengths have 24 bits, so the limits fit into signed 32 bit compares
+  lowLength[classCount - 1] = (min > LIRC_VALUE_MASK) ? LIRC_VALUE_MASK : (int32_t)min - 1;
+  highLength[classCount - 1] = (max > LIRC_VALUE_MASK) ? INT32_MAX : (int32_t)max + 1;
+
+  // Mark all table entries overlapping the window, the ones it covers only partly also as partial
+  for(i = 0; i < PULSE_CLASS_TABLE_SIZE; i++) {
+    uint32_t first = i << PULSE_CLASS_SHIFT;
+    // Longer pulses share the last entry
+    uint32_t last = (i == (PULSE_CLASS_TABLE_SIZE - 1)) ? UINT32_MAX : (first + (1 << PULSE_CLASS_SHIFT) - 1);
+    if((last >= min) && (first <= max)) {
+      pulseClassTable[i] |= class;
+      if((first < min) || (last > max)) {
+        pulseClassPartial[i] |= class;
+      }
+    }
+  }
+
+  PulseClassSelectKernel();
+
+  return class;
+}
+
+/***********************************************************************************************************************
+ * Check a length against the exact limits of the partial windows of its table entry
+ **********************************************************************************************************************/
+PulseClassType PulseClassResolve(uint32_t pulseLength, PulseClassType classes, PulseClassType partial)
+{
+  for(uint32_t i = 0; partial != 0; i++, partial >>= 1) {
+    if((partial & 1) && ((pulseLength < classWindows[i].min) || (pulseLength > classWindows[i].max))) {
+      classes &= ~((PulseClassType)1 << i);
+    }
+  }
+
+  return classes;
+}
+
+/***********************************************************************************************************************
+ * Scalar kernel: table lookup per sample
+ **********************************************************************************************************************/
+static void PulseClassifyScalar(const uint32_t *samples, size_t count, PulseClassType *classes)
+{
+  for(size_t i = 0; i < count; i++) {
+    classes[i] = PulseClassify(samples[i] & LIRC_VALUE_MASK);
+  }
+}
+
+static bool PulseClassAlways(void)
+{
+  return true;
+}
+
+#ifdef PULSE_CLASS_X86
+/***********************************************************************************************************************
+ * SSE2 kernel: compare 4 samples with every window at once
+ **********************************************************************************************************************/
+__attribute__((target("sse2")))
+static void PulseClassifySse2(const uint32_t *samples, size_t count, PulseClassType *classes)
+{
+  const __m128i lengthMask = _mm_set1_epi32(LIRC_VALUE_MASK);
+  size_t i = 0;
+
+  for(; (i + 4) <= count; i += 4) {
+    __m128i length = _mm_and_si128(_mm_loadu_si128((const __m128i *)(samples + i)), lengthMask);
+    __m128i result = _mm_setzero_si128();
+
+    for(unsigned c = 0; c < classCount; c++) {
+      __m128i match = _mm_and_si128(_mm_cmpgt_epi32(length, _mm_set1_epi32(lowLength[c])),
+        _mm_cmplt_epi32(length, _mm_set1_epi32(highLength[c])));
+      result = _mm_or_si128(result, _mm_and_si128(match, _mm_set1_epi32((int32_t)((PulseClassType)1 << c))));
+    }
+    _mm_storeu_si128((__m128i *)(classes + i), result);
+  }
+  PulseClassifyScalar(samples + i, count - i, classes + i);
+}
+
+/***********************************************************************************************************************
+ * AVX2 kernel: table lookup of 8 samples with one gather, entries with partial windows are resolved by the scalar
+ * kernel
+ **********************************************************************************************************************/
+__attribute__((target("avx2")))
+static void PulseClassifyAvx2(const uint32_t *samples, size_t count, PulseClassType *classes)
+{
+  const __m256i lengthMask = _mm256_set1_epi32(LIRC_VALUE_MASK);
+  const __m256i last = _mm256_set1_epi32(PULSE_CLASS_TABLE_SIZE - 1);
+  size_t i = 0;
+
+  for(; (i + 8) <= count; i += 8) {
+    __m256i index = _mm256_srli_epi32(_mm256_and_si256(_mm256_loadu_si256((const __m256i *)(samples + i)),
+      lengthMask), PULSE_CLASS_SHIFT);
+    // Longer pulses share the last entry
+    index = _mm256_min_epu32(index, last);
+    __m256i partial = _mm256_i32gather_epi32((const int *)pulseClassPartial, index, 4);
+    if(_mm256_testz_si256(partial, partial)) {
+      _mm256_storeu_si256((__m256i *)(classes + i), _mm256_i32gather_epi32((const int *)pulseClassTable, index, 4));
+    }
+    else {
+      PulseClassifyScalar(samples + i, 8, classes + i);
+    }
+  }
+  PulseClassifyScalar(samples + i, count - i, classes + i);
+}
+
+static bool PulseClassSse2(void)
+{
+  return __builtin_cpu_supports("sse2");
+}
+
+static bool PulseClassAvx2(void)
+{
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#ifdef PULSE_CLASS_NEON
+/***********************************************************************************************************************
+ * NEON kernel: compare 4 samples with every window at once
+ **********************************************************************************************************************/
+static void PulseClassifyNeon(const uint32_t *samples, size_t count, PulseClassType *classes)
+{
+  const uint32x4_t lengthMask = vdupq_n_u32(LIRC_VALUE_MASK);
+  size_t i = 0;
+
+  for(; (i + 4) <= count; i += 4) {
+    int32x4_t length = vreinterpretq_s32_u32(vandq_u32(vld1q_u32(samples + i), lengthMask));
+    uint32x4_t result = vdupq_n_u32(0);
+
+    for(unsigned c = 0; c < classCount; c++) {
+      uint32x4_t match = vandq_u32(vcgtq_s32(length, vdupq_n_s32(lowLength[c])),
+        vcltq_s32(length, vdupq_n_s32(highLength[c])));
+      result = vorrq_u32(result, vandq_u32(match, vdupq_n_u32((PulseClassType)1 << c)));
+    }
+    vst1q_u32(classes + i, result);
+  }
+  PulseClassifyScalar(samples + i, count - i, classes + i);
+}
+#endif
+
+// Kernels in order of preference
+static const PulseClassKernelType kernels[] = {
+#ifdef PULSE_CLASS_X86
+  { "avx2", PulseClassAvx2, PulseClassifyAvx2, true },
+  { "sse2", PulseClassSse2, PulseClassifySse2, false },
+#endif
+#ifdef PULSE_CLASS_NEON
+  { "neon", PulseClassAlways, PulseClassifyNeon, false },
+#endif
+  { "scalar", PulseClassAlways, PulseClassifyScalar, true },
+};
+
+/***********************************************************************************************************************
+ * Select the fastest batch kernel this CPU supports
+ **********************************************************************************************************************/
+static void PulseClassSelectKernel(void)
+{
+  for(size_t k = 0; k < (sizeof(kernels) / sizeof(kernels[0])); k++) {
+    if(kernels[k].automatic && kernels[k].supported()) {
+      classifyBatch = kernels[k].classify;
+      break;
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Classify a block of raw lirc samples (mode bits are ignored) with the kernel selected for this CPU
+ **********************************************************************************************************************/
+void PulseClassifyBatch(const uint32_t *samples, size_t count, PulseClassType *classes)
+{
+  classifyBatch(samples, count, classes);
+}
+
+/***********************************************************************************************************************
+ * Get monotonic time in seconds
+ **********************************************************************************************************************/
+static double PulseClassSeconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/***********************************************************************************************************************
+ * Classify the samples with every kernel supported by this CPU, check the results against the table lookup and print
+ * the throughput
+ **********************************************************************************************************************/
+void PulseClassBenchmark(const uint32_t *samples, size_t count, FILE *stream)
+{
+  enum { BLOCK = 1024 };
+  PulseClassType expected[BLOCK], classes[BLOCK];
+
+  fprintf(stream, "classifier: %u classes, %zu samples\n", classCount, count);
+  for(size_t k = 0; k < (sizeof(kernels) / sizeof(kernels[0])); k++) {
+    const PulseClassKernelType *kernel = &kernels[k];
+    uint64_t pulses = 0;
+    bool valid = true;
+    double start, elapsed;
+
+    if(!kernel->supported()) {
+      fprintf(stream, "  %-8s not supported\n", kernel->name);
+      continue;
+    }
+
+    for(size_t i = 0; i < count; i += BLOCK) {
+      size_t length = ((count - i) < BLOCK) ? (count - i) : BLOCK;
+      PulseClassifyScalar(samples + i, length, expected);
+      kernel->classify(samples + i, length, classes);
+      for(size_t j = 0; j < length; j++) {
+        valid = valid && (classes[j] == expected[j]);
+      }
+    }
+
+    // Run for at least half a second
+    start = PulseClassSeconds();
+    do {
+      for(size_t i = 0; i < count; i += BLOCK) {
+        size_t length = ((count - i) < BLOCK) ? (count - i) : BLOCK;
+        kernel->classify(samples + i, length, classes);
+      }
+      pulses += count;
+      elapsed = PulseClassSeconds() - start;
+    } while((elapsed < 0.5) && (count > 0));
+
+    fprintf(stream, "  %-8s %12.0f pulses/s%s%s\n", kernel->name, (elapsed > 0) ? pulses / elapsed : 0.0,
+      (kernel->classify == classifyBatch) ? ", selected" : "", valid ? "" : ", MISMATCH");
+  }
+}
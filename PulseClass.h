@@ -0,0 +1,76 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef PULSE_CLASS_H_
+#define PULSE_CLASS_H_
+
+#include <stdio.h>
+#include "types.h"
+
+// Pulse lengths are classified with this resolution (1 << PULSE_CLASS_SHIFT us)
+#define PULSE_CLASS_SHIFT       3
+// Number of table entries, longer pulses share the last entry
+#define PULSE_CLASS_TABLE_SIZE  2048
+// Longest pulse length a bounded window may have
+#define PULSE_CLASS_MAX_LENGTH  ((PULSE_CLASS_TABLE_SIZE << PULSE_CLASS_SHIFT) - 1)
+// Upper limit for open windows
+#define PULSE_CLASS_UNLIMITED   UINT32_MAX
+
+// Classification table: pulse length -> bit mask of length windows overlapping the table entry
+extern PulseClassType pulseClassTable[PULSE_CLASS_TABLE_SIZE];
+// Windows covering the table entry only partly, a length in the entry is checked against their exact limits
+extern PulseClassType pulseClassPartial[PULSE_CLASS_TABLE_SIZE];
+
+PulseClassType PulseClassAdd(uint32_t min, uint32_t max);
+PulseClassType PulseClassResolve(uint32_t pulseLength, PulseClassType classes, PulseClassType partial);
+void PulseClassifyBatch(const uint32_t *samples, size_t count, PulseClassType *classes);
+void PulseClassBenchmark(const uint32_t *samples, size_t count, FILE *stream);
+
+/***********************************************************************************************************************
+ * Get the classes a pulse length belongs to
+ **********************************************************************************************************************/
+static inline PulseClassType PulseClassify(uint32_t pulseLength)
+{
+  uint32_t index = pulseLength >> PULSE_CLASS_SHIFT;
+
+  if(index >= PULSE_CLASS_TABLE_SIZE) {
+    index = PULSE_CLASS_TABLE_SIZE - 1;
+  }
+  if(pulseClassPartial[index] != 0) {
+    return PulseClassResolve(pulseLength, pulseClassTable[index], pulseClassPartial[index]);
+  }
+
+  return pulseClassTable[index];
+}
+
+#endif // PULSE_CLASS_H_
@@ -0,0 +1,253 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/lirc.h>
+#include "PulseInput.h"
+
+/***********************************************************************************************************************
+ * Open input device
+ **********************************************************************************************************************/
+bool PulseInputOpen(PulseInputContext *ctx, const char *name)
+{
+  memset(ctx, 0, sizeof(PulseInputContext));
+  ctx->mode = PulseInputLive;
+  ctx->fd = open(name, O_RDONLY);
+
+  return ctx->fd != -1;
+}
+
+/***********************************************************************************************************************
+ * Open lirc device, asking the driver to report receiver timeouts so frames are completed without waiting for the next
+ * pulse. Drivers that always report them or cannot do it do not support the request, that is no error.
+ **********************************************************************************************************************/
+bool PulseInputOpenDevice(PulseInputContext *ctx, const char *name)
+{
+  uint32_t enable = 1;
+
+  if(!PulseInputOpen(ctx, name)) {
+    return false;
+  }
+  ioctl(ctx->fd, LIRC_SET_REC_TIMEOUT_REPORTS, &enable);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Open a recorded capture file (raw samples as read from the lirc device) for replay
+ **********************************************************************************************************************/
+bool PulseInputOpenReplay(PulseInputContext *ctx, const char *name)
+{
+  struct stat st;
+  void *map;
+
+  if(!PulseInputOpen(ctx, name)) {
+    return false;
+  }
+
+  if(fstat(ctx->fd, &st) == -1) {
+    return false;
+  }
+
+  ctx->mode = PulseInputReplay;
+  ctx->mapSamples = st.st_size / sizeof(uint32_t);
+  // Empty capture, nothing to map
+  if(ctx->mapSamples == 0) {
+    return true;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, ctx->fd, 0);
+  if(map == MAP_FAILED) {
+    return false;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  ctx->map = map;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Open a compact pulse archive for replay, starting at the given wall clock time in us
+ **********************************************************************************************************************/
+bool PulseInputOpenArchive(PulseInputContext *ctx, const char *name, uint64_t startTime)
+{
+  memset(ctx, 0, sizeof(PulseInputContext));
+  ctx->mode = PulseInputArchive;
+  ctx->fd = -1;
+
+  if(!PulseArchiveReaderOpen(&ctx->archive, name)) {
+    return false;
+  }
+  PulseArchiveReaderSeek(&ctx->archive, startTime);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Close input
+ **********************************************************************************************************************/
+void PulseInputClose(PulseInputContext *ctx)
+{
+  if(ctx->map != NULL) {
+    munmap((void *)ctx->map, ctx->mapSamples * sizeof(uint32_t));
+  }
+  ctx->map = NULL;
+
+  if(ctx->mode == PulseInputArchive) {
+    PulseArchiveReaderClose(&ctx->archive);
+  }
+
+  if(ctx->fd != -1) {
+    close(ctx->fd);
+    ctx->fd = -1;
+  }
+}
+
+/***********************************************************************************************************************
+ * Hand out the next chunk of the memory mapped capture
+ **********************************************************************************************************************/
+static ssize_t PulseInputReadReplay(PulseInputContext *ctx, const uint32_t **samples)
+{
+  size_t count = ctx->mapSamples - ctx->mapPosition;
+
+  if(count > PULSE_INPUT_REPLAY_CHUNK) {
+    count = PULSE_INPUT_REPLAY_CHUNK;
+  }
+
+  *samples = ctx->map + ctx->mapPosition;
+  ctx->mapPosition += count;
+
+  // Update statistics
+  if(count > 0) {
+    ctx->wakeups++;
+    ctx->samples += count;
+    if(count > ctx->maxBatch) {
+      ctx->maxBatch = count;
+    }
+  }
+
+  return count;
+}
+
+/***********************************************************************************************************************
+ * Decode the next samples from the archive
+ **********************************************************************************************************************/
+static ssize_t PulseInputReadArchive(PulseInputContext *ctx, const uint32_t **samples)
+{
+  uint64_t syncTime;
+  ssize_t count = PulseArchiveReaderRead(&ctx->archive, ctx->buffer, PULSE_INPUT_BUFFER_SIZE, &syncTime);
+
+  if(count < 0) {
+    errno = EILSEQ;
+    return count;
+  }
+
+  // Time stamps must be resynchronized at block sync points
+  ctx->syncTime = syncTime;
+
+  // Update statistics
+  if(count > 0) {
+    ctx->wakeups++;
+    ctx->samples += count;
+    if(count > ctx->maxBatch) {
+      ctx->maxBatch = count;
+    }
+  }
+
+  *samples = ctx->buffer;
+  return count;
+}
+
+/***********************************************************************************************************************
+ * Read all available samples. Blocks until at least one sample is available.
+ * Returns the number of samples, 0 on end of file and -1 on error.
+ **********************************************************************************************************************/
+ssize_t PulseInputRead(PulseInputContext *ctx, const uint32_t **samples)
+{
+  // Buffer as bytes
+  uint8_t *buffer = (uint8_t *)ctx->buffer;
+  // Number of bytes read
+  ssize_t length;
+  // Number of complete samples
+  size_t count;
+
+  // Replay modes
+  if(ctx->mode == PulseInputReplay) {
+    return PulseInputReadReplay(ctx, samples);
+  }
+  else if(ctx->mode == PulseInputArchive) {
+    return PulseInputReadArchive(ctx, samples);
+  }
+
+  // Continue with the incomplete sample from the previous read
+  memcpy(buffer, ctx->partial, ctx->partialLength);
+
+  // Fetch as much as the driver has for us
+  length = read(ctx->fd, buffer + ctx->partialLength, sizeof(ctx->buffer) - ctx->partialLength);
+  if(length <= 0) {
+    return length;
+  }
+  length += ctx->partialLength;
+
+  // Keep an incomplete sample for the next read
+  count = length / sizeof(ctx->buffer[0]);
+  ctx->partialLength = length % sizeof(ctx->buffer[0]);
+  memcpy(ctx->partial, buffer + (count * sizeof(ctx->buffer[0])), ctx->partialLength);
+
+  // Update statistics
+  ctx->wakeups++;
+  ctx->samples += count;
+  if(count > ctx->maxBatch) {
+    ctx->maxBatch = count;
+  }
+
+  *samples = ctx->buffer;
+  return count;
+}
+
+/***********************************************************************************************************************
+ * Print input statistics
+ **********************************************************************************************************************/
+void PulseInputPrintStatistics(PulseInputContext *ctx, const char *name, FILE *stream)
+{
+  fprintf(stream, "%s: %llu wakeups, %llu samples, %.1f samples/wakeup, %u max\n",
+    name, (unsigned long long)ctx->wakeups, (unsigned long long)ctx->samples,
+    ctx->wakeups ? (double)ctx->samples / ctx->wakeups : 0.0, ctx->maxBatch);
+  fflush(stream);
+}
@@ -0,0 +1,91 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef PULSE_INPUT_H_
+#define PULSE_INPUT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "PulseArchive.h"
+
+// Maximum number of samples fetched from the driver with a single read()
+#define PULSE_INPUT_BUFFER_SIZE   1024
+
+// Maximum number of samples handed out at once in replay mode
+#define PULSE_INPUT_REPLAY_CHUNK  65536
+
+// Input modes
+typedef enum {
+  // Lirc device
+  PulseInputLive,
+  // Memory mapped capture file
+  PulseInputReplay,
+  // Compact pulse archive
+  PulseInputArchive
+} PulseInputModeType;
+
+// Pulse input context
+typedef struct {
+  PulseInputModeType mode;
+  // Device file descriptor
+  int fd;
+  // Memory mapped capture file
+  const uint32_t *map;
+  size_t mapSamples;
+  size_t mapPosition;
+  // Sample buffer
+  uint32_t buffer[PULSE_INPUT_BUFFER_SIZE];
+  // Incomplete sample left over from the previous read
+  uint8_t partial[sizeof(uint32_t)];
+  size_t partialLength;
+  // Archive reader
+  PulseArchiveReader archive;
+  // Wall clock time in us of the first sample of the last read if it is a sync point, otherwise 0
+  uint64_t syncTime;
+  // Statistics
+  uint64_t wakeups;
+  uint64_t samples;
+  uint32_t maxBatch;
+} PulseInputContext;
+
+bool PulseInputOpen(PulseInputContext *ctx, const char *name);
+bool PulseInputOpenDevice(PulseInputContext *ctx, const char *name);
+bool PulseInputOpenReplay(PulseInputContext *ctx, const char *name);
+bool PulseInputOpenArchive(PulseInputContext *ctx, const char *name, uint64_t startTime);
+void PulseInputClose(PulseInputContext *ctx);
+ssize_t PulseInputRead(PulseInputContext *ctx, const uint32_t **samples);
+void PulseInputPrintStatistics(PulseInputContext *ctx, const char *name, FILE *stream);
+
+#endif // PULSE_INPUT_H_
@@ -0,0 +1,229 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "types.h"
+#include "Replay.h"
+
+// Part of the capture decoded on its own
+typedef struct {
+  // Samples
+  size_t first;
+  size_t count;
+  // Pulse time at the first sample in us
+  uint64_t startTime;
+  // Decoded messages
+  OutputListType list;
+  // Decoding finished
+  bool done;
+} ReplayChunkType;
+
+// Parallel replay
+typedef struct {
+  const uint32_t *samples;
+  const char *tag;
+  const DecoderConfigType *config;
+  // Chunks of the capture and the next one to be taken by a thread
+  ReplayChunkType *chunks;
+  size_t chunkCount;
+  atomic_size_t next;
+  // Threads stop taking chunks
+  atomic_bool stop;
+  // Signals finished chunks
+  pthread_mutex_t lock;
+  pthread_cond_t finished;
+} ReplayType;
+
+/***********************************************************************************************************************
+ * Split the capture after long spaces into chunks of at least REPLAY_CHUNK_SAMPLES samples. No frame and no duplicate
+ * filter state survives such a space, so the chunks decode exactly like the whole capture.
+ **********************************************************************************************************************/
+static void ReplaySplit(ReplayType *replay, size_t count)
+{
+  size_t size = 0;
+  size_t first = 0;
+  uint64_t time = 0;
+  uint64_t startTime = 0;
+
+  replay->chunkCount = 0;
+  replay->chunks = NULL;
+
+  for(size_t i = 0; i < count; i++) {
+    uint32_t mode = replay->samples[i] & LIRC_MODE2_MASK;
+    uint32_t length = replay->samples[i] & LIRC_VALUE_MASK;
+    bool last = (i == (count - 1));
+
+    // Carrier frequency reports do not advance the pulse clock
+    if(mode != LIRC_MODE2_FREQUENCY) {
+      time += length;
+    }
+
+    if(last || (((i + 1 - first) >= REPLAY_CHUNK_SAMPLES) && (mode != LIRC_MODE2_PULSE) &&
+       (mode != LIRC_MODE2_FREQUENCY) && (length >= REPLAY_SPLIT_SPACE))) {
+      if(replay->chunkCount >= size) {
+        size = size ? (size * 2) : 64;
+        replay->chunks = realloc(replay->chunks, size * sizeof(ReplayChunkType));
+        if(replay->chunks == NULL) {
+          perror("realloc()");
+          exit(EXIT_FAILURE);
+        }
+      }
+      // The space closing the frames stays in the chunk
+      replay->chunks[replay->chunkCount++] = (ReplayChunkType) {
+        .first = first, .count = i + 1 - first, .startTime = startTime, .list = { NULL, 0, 0 }, .done = false
+      };
+      first = i + 1;
+      startTime = time;
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Decoder thread: take the next chunk until there are none left. Each chunk gets fresh decoders with the pulse clock
+ * set to its start.
+ **********************************************************************************************************************/
+static void *ReplayWorker(void *arg)
+{
+  ReplayType *replay = arg;
+  DecoderContext *decoder = calloc(1, sizeof(DecoderContext));
+  size_t i;
+
+  if(decoder == NULL) {
+    perror("calloc()");
+    exit(EXIT_FAILURE);
+  }
+
+  while(!atomic_load(&replay->stop) && ((i = atomic_fetch_add(&replay->next, 1)) < replay->chunkCount)) {
+    ReplayChunkType *chunk = &replay->chunks[i];
+    OutputTargetType target = { .queue = NULL, .list = &chunk->list };
+
+    DecoderInit(decoder, replay->tag, TimeStampPulseTime, replay->config, &target);
+    TimeStampSync(&decoder->clock, chunk->startTime);
+    DecoderProcess(decoder, replay->samples + chunk->first, chunk->count);
+    DecoderFree(decoder);
+
+    pthread_mutex_lock(&replay->lock);
+    chunk->done = true;
+    pthread_cond_broadcast(&replay->finished);
+    pthread_mutex_unlock(&replay->lock);
+  }
+
+  free(decoder);
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Decode a memory mapped capture with config->threads threads. The messages are output chunk by chunk in capture
+ * order, exactly like a serial replay. The pulse classes must have been registered before (by
+ * initializing a decoder context with the same configuration), the threads only look them up.
+ **********************************************************************************************************************/
+void ReplayParallel(const uint32_t *samples, size_t count, const char *tag, const DecoderConfigType *config,
+  volatile sig_atomic_t *terminate)
+{
+  static ReplayType replay;
+  pthread_t threads[DECODER_MAX_THREADS];
+  sigset_t all, previous;
+  unsigned threadCount = 0;
+  int error = 0;
+
+  replay.samples = samples;
+  replay.tag = tag;
+  replay.config = config;
+  atomic_init(&replay.next, 0);
+  atomic_init(&replay.stop, false);
+  pthread_mutex_init(&replay.lock, NULL);
+  pthread_cond_init(&replay.finished, NULL);
+  ReplaySplit(&replay, count);
+
+  // Signals are handled by the calling thread only, the threads inherit the blocked signals
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &previous);
+  while((threadCount < config->threads) && (threadCount < replay.chunkCount) && (error == 0)) {
+    error = pthread_create(&threads[threadCount], NULL, ReplayWorker, &replay);
+    if(error == 0) {
+      threadCount++;
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  if(error != 0) {
+    errno = error;
+    perror("pthread_create()");
+    exit(EXIT_FAILURE);
+  }
+
+  // Output the chunks in order as soon as they are decoded
+  for(size_t i = 0; (i < replay.chunkCount) && !*terminate; i++) {
+    ReplayChunkType *chunk = &replay.chunks[i];
+
+    pthread_mutex_lock(&replay.lock);
+    while(!chunk->done && !*terminate) {
+      struct timespec timeout;
+
+      // Wake up now and then to look at the termination request
+      clock_gettime(CLOCK_REALTIME, &timeout);
+      timeout.tv_nsec += 100000000;
+      if(timeout.tv_nsec >= 1000000000) {
+        timeout.tv_sec++;
+        timeout.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&replay.finished, &replay.lock, &timeout);
+    }
+    pthread_mutex_unlock(&replay.lock);
+
+    if(chunk->done) {
+      for(size_t m = 0; m < chunk->list.count; m++) {
+        OutputDeliver(&chunk->list.records[m]);
+      }
+      OutputFlush();
+      free(chunk->list.records);
+      chunk->list.records = NULL;
+    }
+  }
+
+  atomic_store(&replay.stop, true);
+  for(unsigned t = 0; t < threadCount; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  for(size_t i = 0; i < replay.chunkCount; i++) {
+    free(replay.chunks[i].list.records);
+  }
+  free(replay.chunks);
+  pthread_mutex_destroy(&replay.lock);
+  pthread_cond_destroy(&replay.finished);
+}
@@ -0,0 +1,125 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <string.h>
+#include "SampleRing.h"
+
+// Slot index mask
+#define SLOT_MASK                 (SAMPLE_RING_SLOTS - 1)
+
+/***********************************************************************************************************************
+ * Start with an empty ring read by the given number of consumers
+ **********************************************************************************************************************/
+void SampleRingInit(SampleRingType *ring, unsigned consumers)
+{
+  atomic_init(&ring->head, 0);
+  for(unsigned i = 0; i < SAMPLE_RING_MAX_CONSUMERS; i++) {
+    atomic_init(&ring->cursors[i].tail, 0);
+  }
+  ring->consumers = consumers;
+  atomic_init(&ring->highWater, 0);
+  atomic_init(&ring->overflows, 0);
+  atomic_init(&ring->droppedSamples, 0);
+}
+
+/***********************************************************************************************************************
+ * Copy a batch into the ring (producer only). Never blocks: if the slowest consumer is a full ring behind, the batch is
+ * dropped and counted.
+ **********************************************************************************************************************/
+bool SampleRingPush(SampleRingType *ring, uint32_t receiver, uint64_t time, const uint32_t *samples, size_t count)
+{
+  unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned fill = 0;
+  SampleBatchType *batch;
+
+  // Fill level seen by the slowest consumer
+  for(unsigned i = 0; i < ring->consumers; i++) {
+    unsigned behind = head - atomic_load_explicit(&ring->cursors[i].tail, memory_order_acquire);
+    if(behind > fill) {
+      fill = behind;
+    }
+  }
+
+  if((fill >= SAMPLE_RING_SLOTS) || (count > PULSE_INPUT_BUFFER_SIZE)) {
+    atomic_fetch_add_explicit(&ring->overflows, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ring->droppedSamples, count, memory_order_relaxed);
+    return false;
+  }
+
+  batch = &ring->slots[head & SLOT_MASK];
+  batch->time = time;
+  batch->receiver = receiver;
+  batch->count = count;
+  memcpy(batch->samples, samples, count * sizeof(samples[0]));
+  // Publish the batch after its contents
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+  if((fill + 1) > atomic_load_explicit(&ring->highWater, memory_order_relaxed)) {
+    atomic_store_explicit(&ring->highWater, fill + 1, memory_order_relaxed);
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Oldest batch not yet read by a consumer, NULL if there is none
+ **********************************************************************************************************************/
+const SampleBatchType *SampleRingFront(SampleRingType *ring, unsigned consumer)
+{
+  unsigned tail = atomic_load_explicit(&ring->cursors[consumer].tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+  return (head != tail) ? &ring->slots[tail & SLOT_MASK] : NULL;
+}
+
+/***********************************************************************************************************************
+ * Release the oldest batch of a consumer, its slot may be overwritten once all consumers released it
+ **********************************************************************************************************************/
+void SampleRingPop(SampleRingType *ring, unsigned consumer)
+{
+  unsigned tail = atomic_load_explicit(&ring->cursors[consumer].tail, memory_order_relaxed);
+
+  atomic_store_explicit(&ring->cursors[consumer].tail, tail + 1, memory_order_release);
+}
+
+/***********************************************************************************************************************
+ * Print statistics
+ **********************************************************************************************************************/
+void SampleRingPrintStatistics(SampleRingType *ring, FILE *stream)
+{
+  fprintf(stream, "ring: %u/%u batches max, %lu overflows, %lu samples dropped\n",
+    atomic_load_explicit(&ring->highWater, memory_order_relaxed), SAMPLE_RING_SLOTS,
+    atomic_load_explicit(&ring->overflows, memory_order_relaxed),
+    atomic_load_explicit(&ring->droppedSamples, memory_order_relaxed));
+  fflush(stream);
+}
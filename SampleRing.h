@@ -0,0 +1,87 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef SAMPLE_RING_H_
+#define SAMPLE_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include "PulseInput.h"
+
+// Number of batches a ring can hold, power of two
+#define SAMPLE_RING_SLOTS         128
+// Maximum number of consumers reading the ring
+#define SAMPLE_RING_MAX_CONSUMERS 8
+
+// Samples read at once with their source and arrival time
+typedef struct {
+  // Wall clock at the arrival of the batch in us
+  uint64_t time;
+  // Receiver the samples were read from
+  uint32_t receiver;
+  // Number of samples
+  uint32_t count;
+  // Raw lirc samples
+  uint32_t samples[PULSE_INPUT_BUFFER_SIZE];
+} SampleBatchType;
+
+// Read cursor of a consumer, on its own cache line so the threads do not disturb each other
+typedef struct {
+  _Alignas(64) atomic_uint tail;
+} SampleRingCursor;
+
+// Lock-free broadcast ring: one producer (reader) thread, every batch is read by all consumer (decoder) threads at
+// their own cursor. A slot is reused once the slowest consumer has released it.
+typedef struct {
+  SampleBatchType slots[SAMPLE_RING_SLOTS];
+  // Free running write index, written by the producer only
+  _Alignas(64) atomic_uint head;
+  // Free running read indices, written by their consumer only
+  SampleRingCursor cursors[SAMPLE_RING_MAX_CONSUMERS];
+  unsigned consumers;
+  // Statistics of the producer: highest fill level, batches and samples dropped because the ring was full
+  _Alignas(64) atomic_uint highWater;
+  atomic_ulong overflows;
+  atomic_ulong droppedSamples;
+} SampleRingType;
+
+void SampleRingInit(SampleRingType *ring, unsigned consumers);
+bool SampleRingPush(SampleRingType *ring, uint32_t receiver, uint64_t time, const uint32_t *samples, size_t count);
+const SampleBatchType *SampleRingFront(SampleRingType *ring, unsigned consumer);
+void SampleRingPop(SampleRingType *ring, unsigned consumer);
+void SampleRingPrintStatistics(SampleRingType *ring, FILE *stream);
+
+#endif // SAMPLE_RING_H_
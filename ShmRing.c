@@ -0,0 +1,216 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ShmRing.h"
+
+/***********************************************************************************************************************
+ * Name of the shared memory object: the ring name with a leading '/'
+ **********************************************************************************************************************/
+bool ShmRingObjectName(const char *name, char *objectName, size_t size)
+{
+  int length = snprintf(objectName, size, "%s%s", (name[0] == '/') ? "" : "/", name);
+
+  if((name[0] == 0) || (length >= (int)size) || (strchr(objectName + 1, '/') != NULL)) {
+    errno = EINVAL;
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Open a ring for reading, starting with the last backlog readings in it
+ **********************************************************************************************************************/
+bool ShmRingReaderOpen(ShmRingReader *reader, const char *name, uint32_t backlog)
+{
+  char objectName[256];
+  struct stat st;
+  void *map;
+  uint32_t head;
+  // Return value
+  bool retval = false;
+
+  reader->fd = -1;
+  reader->header = NULL;
+  reader->lost = 0;
+
+  if(!ShmRingObjectName(name, objectName, sizeof(objectName))) {
+    goto exit;
+  }
+  reader->fd = shm_open(objectName, O_RDONLY | O_CLOEXEC, 0);
+  if(reader->fd < 0) {
+    goto exit;
+  }
+  if(fstat(reader->fd, &st) == -1) {
+    goto exit;
+  }
+  if(st.st_size < (off_t)sizeof(ShmRingHeaderType)) {
+    errno = EPROTO;
+    goto exit;
+  }
+  reader->size = st.st_size;
+  map = mmap(NULL, reader->size, PROT_READ, MAP_SHARED, reader->fd, 0);
+  if(map == MAP_FAILED) {
+    goto exit;
+  }
+  reader->header = map;
+  reader->slots = (const ShmRingSlotType *)(reader->header + 1);
+
+  // The layout is only valid after the magic number
+  if((atomic_load_explicit(&reader->header->magic, memory_order_acquire) != SHM_RING_MAGIC) ||
+     (reader->header->version != SHM_RING_VERSION) || (reader->header->recordSize != SHM_RING_RECORD_SIZE) ||
+     (reader->header->slotCount == 0) || (reader->header->slotCount & (reader->header->slotCount - 1)) ||
+     (reader->size < (sizeof(ShmRingHeaderType) + reader->header->slotCount * sizeof(ShmRingSlotType)))) {
+    errno = EPROTO;
+    goto exit;
+  }
+
+  head = atomic_load_explicit(&reader->header->head, memory_order_acquire);
+  if(backlog > reader->header->slotCount) {
+    backlog = reader->header->slotCount;
+  }
+  if(backlog > head) {
+    backlog = head;
+  }
+  reader->next = head - backlog;
+  retval = true;
+
+  exit:
+  if(!retval) {
+    int error = errno;
+
+    ShmRingReaderClose(reader);
+    errno = error;
+  }
+  return retval;
+}
+
+/***********************************************************************************************************************
+ * Read a little endian integer
+ **********************************************************************************************************************/
+static uint64_t ShmRingGet(const uint8_t *buffer, unsigned size)
+{
+  uint64_t value = 0;
+
+  for(unsigned i = 0; i < size; i++) {
+    value |= (uint64_t)buffer[i] << (i * 8);
+  }
+
+  return value;
+}
+
+/***********************************************************************************************************************
+ * Decode a reading of the binary output format
+ **********************************************************************************************************************/
+static void ShmRingDecode(const uint8_t *buffer, ShmRingRecordType *record)
+{
+  record->frameLength = buffer[1];
+  record->battery = buffer[2];
+  record->present = buffer[3];
+  record->id = (int32_t)ShmRingGet(buffer + 4, 4);
+  record->channel = (int32_t)ShmRingGet(buffer + 8, 4);
+  for(unsigned q = 0; q < 3; q++) {
+    record->values[q] = (int32_t)ShmRingGet(buffer + 12 + (q * 4), 4);
+  }
+  record->start = ShmRingGet(buffer + 24, 8);
+  record->end = ShmRingGet(buffer + 32, 8);
+  record->frame = ShmRingGet(buffer + 40, 8);
+  memcpy(record->protocol, buffer + 48, SHM_RING_PROTOCOL_LENGTH);
+  record->protocol[SHM_RING_PROTOCOL_LENGTH] = 0;
+  memcpy(record->tag, buffer + 48 + SHM_RING_PROTOCOL_LENGTH, SHM_RING_TAG_LENGTH);
+  record->tag[SHM_RING_TAG_LENGTH] = 0;
+}
+
+/***********************************************************************************************************************
+ * Take the next reading, returns false if there is none yet. Lock-free and without system calls: the slot is copied
+ * and kept only if the writer did not touch it meanwhile. Readings the writer overwrote before they could be taken are
+ * skipped and counted as lost.
+ **********************************************************************************************************************/
+bool ShmRingRead(ShmRingReader *reader, ShmRingRecordType *record)
+{
+  uint32_t slotCount = reader->header->slotCount;
+
+  for(;;) {
+    uint32_t head = atomic_load_explicit(&reader->header->head, memory_order_acquire);
+    uint32_t available = head - reader->next;
+    const ShmRingSlotType *slot;
+    uint8_t buffer[SHM_RING_RECORD_SIZE];
+    uint32_t stamp;
+
+    if(available == 0) {
+      return false;
+    }
+    // Overrun: continue with the oldest reading still in the ring
+    if(available > slotCount) {
+      reader->lost += available - slotCount;
+      reader->next = head - slotCount;
+    }
+
+    slot = &reader->slots[reader->next & (slotCount - 1)];
+    stamp = atomic_load_explicit(&slot->stamp, memory_order_acquire);
+    memcpy(buffer, slot->record, sizeof(buffer));
+    // The copy has to be complete before the stamp is checked again
+    atomic_thread_fence(memory_order_acquire);
+    if((stamp == (reader->next + 1)) && (atomic_load_explicit(&slot->stamp, memory_order_relaxed) == stamp)) {
+      ShmRingDecode(buffer, record);
+      record->sequence = reader->next++;
+      return true;
+    }
+
+    // The slot already belongs to a newer reading
+    reader->lost++;
+    reader->next++;
+  }
+}
+
+/***********************************************************************************************************************
+ * Unmap the ring
+ **********************************************************************************************************************/
+void ShmRingReaderClose(ShmRingReader *reader)
+{
+  if(reader->header != NULL) {
+    munmap((void *)reader->header, reader->size);
+    reader->header = NULL;
+  }
+  if(reader->fd >= 0) {
+    close(reader->fd);
+    reader->fd = -1;
+  }
+}
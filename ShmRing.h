@@ -0,0 +1,117 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef SHMRING_H_
+#define SHMRING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Default ring name (/dev/shm/weather_rx)
+#define SHM_RING_DEFAULT_NAME     "weather_rx"
+// Set up ring marker and layout version
+#define SHM_RING_MAGIC            0x57525852
+#define SHM_RING_VERSION          1
+// Number of readings kept, power of two
+#define SHM_RING_SLOTS            4096
+// Size of a reading, the binary output format (OutputFormat.h) is used
+#define SHM_RING_RECORD_SIZE      72
+// Room for the protocol name and the tag
+#define SHM_RING_PROTOCOL_LENGTH  8
+#define SHM_RING_TAG_LENGTH       16
+
+// Ring header at the beginning of the shared memory. Sequence numbers are 32 bit so that they are lock-free (and
+// therefore usable between processes) on every platform, they wrap around.
+typedef struct {
+  // SHM_RING_MAGIC, written last when the ring is set up
+  atomic_uint magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t recordSize;
+  // Sequence number of the next reading, all readings before it have been published
+  _Alignas(64) atomic_uint head;
+} ShmRingHeaderType;
+
+// Ring slot
+typedef struct {
+  // Sequence number of the reading plus one, 0 while the slot is being written
+  atomic_uint stamp;
+  uint8_t record[SHM_RING_RECORD_SIZE];
+} ShmRingSlotType;
+
+// Reading taken from the ring
+typedef struct {
+  // Sequence number
+  uint32_t sequence;
+  // Battery status (OutputBatteryType) and frame length
+  uint8_t battery;
+  uint8_t frameLength;
+  // Bit n is set if quantity n (OutputQuantityType) was received
+  uint8_t present;
+  // Sensor id and channel, -1 if the protocol has none
+  int32_t id;
+  int32_t channel;
+  // Temperature in 0.1 degrees Celsius, humidity in %, switch state
+  int32_t values[3];
+  // Time stamps of the first and the last bit in us
+  uint64_t start;
+  uint64_t end;
+  // Frame, the first received bit is the MSB
+  uint64_t frame;
+  // Protocol name and receiver tag (empty if there is none)
+  char protocol[SHM_RING_PROTOCOL_LENGTH + 1];
+  char tag[SHM_RING_TAG_LENGTH + 1];
+} ShmRingRecordType;
+
+// Reader following a ring
+typedef struct {
+  // Mapped ring
+  int fd;
+  size_t size;
+  const ShmRingHeaderType *header;
+  const ShmRingSlotType *slots;
+  // Sequence number of the next reading to take
+  uint32_t next;
+  // Readings overwritten before they could be taken
+  uint64_t lost;
+} ShmRingReader;
+
+bool ShmRingObjectName(const char *name, char *objectName, size_t size);
+
+bool ShmRingReaderOpen(ShmRingReader *reader, const char *name, uint32_t backlog);
+bool ShmRingRead(ShmRingReader *reader, ShmRingRecordType *record);
+void ShmRingReaderClose(ShmRingReader *reader);
+
+#endif // SHMRING_H_
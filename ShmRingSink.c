@@ -0,0 +1,155 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Output.h"
+#include "OutputFormat.h"
+#include "ShmRingSink.h"
+
+_Static_assert(SHM_RING_RECORD_SIZE == OUTPUT_BINARY_SIZE, "ring slots hold binary output records");
+_Static_assert(SHM_RING_PROTOCOL_LENGTH == OUTPUT_BINARY_PROTOCOL, "protocol name length differs");
+_Static_assert(SHM_RING_TAG_LENGTH == OUTPUT_BINARY_TAG, "tag length differs");
+
+// Size of the shared memory object
+#define SHM_RING_SIZE             (sizeof(ShmRingHeaderType) + (SHM_RING_SLOTS * sizeof(ShmRingSlotType)))
+
+// Ring written by the output stage
+typedef struct {
+  int fd;
+  ShmRingHeaderType *header;
+  ShmRingSlotType *slots;
+} ShmRingSinkContext;
+
+/***********************************************************************************************************************
+ * Check if an existing ring has the layout of this version, it is continued then
+ **********************************************************************************************************************/
+static bool ShmRingSinkCompatible(const ShmRingHeaderType *header)
+{
+  return (atomic_load_explicit(&header->magic, memory_order_acquire) == SHM_RING_MAGIC) &&
+    (header->version == SHM_RING_VERSION) && (header->slotCount == SHM_RING_SLOTS) &&
+    (header->recordSize == SHM_RING_RECORD_SIZE);
+}
+
+/***********************************************************************************************************************
+ * Publish a reading: mark the slot as being written, fill it, stamp it with its sequence number and advance the head
+ **********************************************************************************************************************/
+static void ShmRingSinkWrite(void *ctx, const OutputRecordType *record)
+{
+  ShmRingSinkContext *ring = ctx;
+  uint32_t sequence = atomic_load_explicit(&ring->header->head, memory_order_relaxed);
+  ShmRingSlotType *slot = &ring->slots[sequence & (SHM_RING_SLOTS - 1)];
+
+  atomic_store_explicit(&slot->stamp, 0, memory_order_relaxed);
+  // Readers must see the mark before the new contents
+  atomic_thread_fence(memory_order_release);
+  OutputBinaryEncode(record, slot->record);
+  atomic_store_explicit(&slot->stamp, sequence + 1, memory_order_release);
+  atomic_store_explicit(&ring->header->head, sequence + 1, memory_order_release);
+}
+
+/***********************************************************************************************************************
+ * Unmap the ring, it stays in place with the last readings for the readers
+ **********************************************************************************************************************/
+static void ShmRingSinkClose(void *ctx)
+{
+  ShmRingSinkContext *ring = ctx;
+
+  munmap(ring->header, SHM_RING_SIZE);
+  close(ring->fd);
+}
+
+/***********************************************************************************************************************
+ * Create the ring /dev/shm/<name> (SHM_RING_DEFAULT_NAME if name is NULL) and publish the readings of the output stage
+ * into it. A ring left by an earlier run is continued, its readers keep following it. There must be only one writer.
+ **********************************************************************************************************************/
+bool ShmRingSinkOpen(const char *name)
+{
+  static ShmRingSinkContext ring;
+  char objectName[256];
+  void *map;
+  // Return value
+  bool retval = false;
+
+  if(name == NULL) {
+    name = SHM_RING_DEFAULT_NAME;
+  }
+  if(!ShmRingObjectName(name, objectName, sizeof(objectName))) {
+    fprintf(stderr, "Invalid shared memory ring name: %s\n", name);
+    return false;
+  }
+
+  ring.fd = shm_open(objectName, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if(ring.fd < 0) {
+    goto exit;
+  }
+  if(ftruncate(ring.fd, SHM_RING_SIZE) == -1) {
+    goto exit;
+  }
+  map = mmap(NULL, SHM_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd, 0);
+  if(map == MAP_FAILED) {
+    goto exit;
+  }
+  ring.header = map;
+  ring.slots = (ShmRingSlotType *)(ring.header + 1);
+
+  // Set up a new ring, the magic number tells the readers when it is ready
+  if(!ShmRingSinkCompatible(ring.header)) {
+    atomic_store_explicit(&ring.header->magic, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memset(ring.slots, 0, SHM_RING_SLOTS * sizeof(ShmRingSlotType));
+    ring.header->version = SHM_RING_VERSION;
+    ring.header->slotCount = SHM_RING_SLOTS;
+    ring.header->recordSize = SHM_RING_RECORD_SIZE;
+    atomic_store_explicit(&ring.header->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring.header->magic, SHM_RING_MAGIC, memory_order_release);
+  }
+
+  OutputAddSink(&(OutputSinkType) {
+    .name = "shm", .write = ShmRingSinkWrite, .flush = NULL, .close = ShmRingSinkClose, .ctx = &ring
+  });
+  retval = true;
+
+  exit:
+  if(!retval) {
+    perror(objectName);
+    if(ring.fd >= 0) {
+      close(ring.fd);
+    }
+  }
+  return retval;
+}
@@ -0,0 +1,105 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stddef.h>
+#include <time.h>
+#include "TimeStamp.h"
+
+/***********************************************************************************************************************
+ * Get a system clock in us
+ **********************************************************************************************************************/
+static uint64_t TimeStampClock(clockid_t clock)
+{
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/***********************************************************************************************************************
+ * Initialize clock with the selected time stamp source
+ **********************************************************************************************************************/
+void TimeStampInit(TimeStampContext *ctx, TimeStampSourceType source)
+{
+  ctx->source = source;
+  ctx->pulseTime = 0;
+  ctx->minimum = 0;
+  ctx->anchored = false;
+}
+
+/***********************************************************************************************************************
+ * Set pulse time to a wall clock sync point in us
+ **********************************************************************************************************************/
+void TimeStampSync(TimeStampContext *ctx, uint64_t time)
+{
+  ctx->pulseTime = time;
+  ctx->minimum = 0;
+}
+
+/***********************************************************************************************************************
+ * Get the monotonic clock in us
+ **********************************************************************************************************************/
+uint64_t TimeStampMonotonic(void)
+{
+  return TimeStampClock(CLOCK_MONOTONIC);
+}
+
+/***********************************************************************************************************************
+ * Get the offset from the monotonic clock to the wall clock in us. Arrival times are taken from the monotonic clock
+ * plus an offset determined once, so wall clock steps do not disturb the time stamps.
+ **********************************************************************************************************************/
+int64_t TimeStampWallOffset(void)
+{
+  return TimeStampClock(CLOCK_REALTIME) - TimeStampClock(CLOCK_MONOTONIC);
+}
+
+/***********************************************************************************************************************
+ * Anchor pulse time to the wall clock arrival time of a batch of pulses lasting duration us. Called before decoding
+ * every batch: the batch started at its arrival time minus its duration. The pulse clock is corrected in both
+ * directions, time stamps stay monotonic as they do not fall below the ones handed out before the clock was set back.
+ * Replay time stamps depend on the pulses only.
+ **********************************************************************************************************************/
+void TimeStampAnchor(TimeStampContext *ctx, uint64_t time, uint64_t duration)
+{
+  uint64_t start = (time > duration) ? (time - duration) : 0;
+
+  if(ctx->source == TimeStampRealTime) {
+    if(!ctx->anchored || (start > (ctx->pulseTime + TIME_STAMP_DRIFT_MAX)) ||
+       ((start + TIME_STAMP_DRIFT_MAX) < ctx->pulseTime)) {
+      if(ctx->anchored && (start < ctx->pulseTime)) {
+        ctx->minimum = TimeStampGet(ctx);
+      }
+      ctx->pulseTime = start;
+      ctx->anchored = true;
+    }
+  }
+}
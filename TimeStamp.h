@@ -0,0 +1,87 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef TIME_STAMP_H_
+#define TIME_STAMP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Largest difference between the pulse clock and the system clock in us before the pulse clock is corrected. Long
+// spaces are clamped by lirc, so idle periods may be missing from the pulse durations, and the receiver clock may run
+// faster or slower than the system clock.
+#define TIME_STAMP_DRIFT_MAX      250000
+
+// Time stamp sources
+typedef enum {
+  // Accumulated pulse / space durations, anchored to the system clock (live receivers)
+  TimeStampRealTime,
+  // Accumulated pulse / space durations only (replay)
+  TimeStampPulseTime
+} TimeStampSourceType;
+
+// Time stamp clock context
+typedef struct {
+  // Selected source
+  TimeStampSourceType source;
+  // Accumulated pulse time in us, wall clock time if anchored or synchronized
+  uint64_t pulseTime;
+  // Latest time stamp possibly handed out before the pulse clock was set back, later ones are not earlier
+  uint64_t minimum;
+  // Pulse time anchored to the system clock at least once
+  bool anchored;
+} TimeStampContext;
+
+void TimeStampInit(TimeStampContext *ctx, TimeStampSourceType source);
+void TimeStampSync(TimeStampContext *ctx, uint64_t time);
+void TimeStampAnchor(TimeStampContext *ctx, uint64_t time, uint64_t duration);
+uint64_t TimeStampMonotonic(void);
+int64_t TimeStampWallOffset(void);
+
+/***********************************************************************************************************************
+ * Advance pulse time by the length of a received pulse or space
+ **********************************************************************************************************************/
+static inline void TimeStampAdvance(TimeStampContext *ctx, uint32_t pulseLength)
+{
+  ctx->pulseTime += pulseLength;
+}
+
+/***********************************************************************************************************************
+ * Get actual time stamp in us, no system call involved
+ **********************************************************************************************************************/
+static inline uint64_t TimeStampGet(const TimeStampContext *ctx)
+{
+  return (ctx->pulseTime > ctx->minimum) ? ctx->pulseTime : ctx->minimum;
+}
+
+#endif // TIME_STAMP_H_
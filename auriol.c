@@ -34,221 +34,39 @@
 #include "config.h"
 #ifdef MODULE_AURIOL_ENABLE
 
-#include <stdio.h>
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <sys/time.h>
-#include "types.h"
 #include "DecodePulseSpace.h"
-
-#ifndef ANALOG_FILTER
-
-// Pulse length in us
-#define PULSE_LENGTH       500
-// Space length for bit ZERO in us
-#define ZERO_LENGTH       2000
-// Space length for bit ONE in us
-#define ONE_LENGTH        4000
-
-#else // ANALOG_FILTER
-// The Analog filter alters the pulse / space timings
-
-// Pulse length in us
-#define PULSE_LENGTH       662
-// Space length for bit ZERO in us
-#define ZERO_LENGTH       1780
-// Space length for bit ONE in us
-#define ONE_LENGTH        3850
-
-#endif // ANALOG_FILTER
-
-// Signal timing tolerance in us
-#define TOLERANCE          200
-
-// Search for identical messages within this timeframe in uS
-#define DUPLICATE_TIME     1000000
-
-// Decoded data
-typedef struct {
-  uint8_t id;
-  uint8_t battery;
-  uint8_t status;
-  uint8_t button;
-  int16_t temperature;
-  uint8_t humidity;
-  uint8_t checksum;
-  uint32_t timeStamp;
-} AuriolData;
-
-/***********************************************************************************************************************
- * Auriol Message Decoder
- **********************************************************************************************************************/
-static bool AuriolDecode(AuriolData *data, BitType bit)
-{
-  // Bit number counter
-  static uint8_t bitNr = 0;
-  // Checksum calculation
-  static uint8_t checksum = 0;
-  // Return value
-  bool retval = false;
-  // Recheck some bits
-  bool reCheck;
-
-  // Only process valid bits
-  if(!(bit & BIT_VALID)) {
-    goto exit;
-  }
-
-  do {
-    // Only Recheck once
-    reCheck = false;
-
-    // Clear all data at the beginning
-    if(bitNr == 0) {
-      memset(data, 0, sizeof(AuriolData));
-      data->checksum = 0xF;
-      checksum = 0;
-    }
-    else {
-      // All bits except the first must be in a bit stream
-      if(!(bit & BIT_IN_STREAM)) {
-//        printf("Bit not in stream: %u\n", bitNr);
-        bitNr = 0;
-        // Check again this bit, maybe it's the start of a new telegram
-        reCheck = true;
-        continue;
-      }
-    }
-    // Remove flags
-    bit &= BIT_ONE;
-
-    // ID [0 .. 7]
-    if(bitNr <= 7) {
-      data->id = (data->id >> 1) | (bit << 7);
-    }
-    // Battery [8]
-    else if(bitNr == 8) {
-      data->battery = bit;
-    }
-    // Status [9 .. 10]
-    else if((bitNr >= 9) && (bitNr <= 10)) {
-      data->status = (data->status >> 1) | (bit << 1);
-    }
-    // Button [11]
-    else if(bitNr == 11) {
-      data->button = bit;
-    }
-    // Temperature [12 .. 23]
-    else if((bitNr >= 12) && (bitNr <= 23)) {
-      data->temperature = (data->temperature >> 1) | (bit << 11);
-    }
-    // Humidity [24 .. 31]
-    else if((bitNr >= 24) && (bitNr <= 31)) {
-      data->humidity = (data->humidity >> 1) | (bit << 7);
-    }
-
-    // Update checksum
-    checksum = (checksum >> 1) | (bit << 3);
-    if(((bitNr + 1) & 3) == 0) {
-      data->checksum = (data->checksum - checksum) & 0xF;
-    }
-
-    // and check checksum if appropriate
-    if(bitNr == 35) {
-      // If checksum and packet type correct
-      if((data->checksum == 0) && (data->status != 3)) {
-        // Record reception Timestamp
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        data->timeStamp = (tv.tv_sec * 1000000) + tv.tv_usec;
-        // Make the 12 bit temperature a 16 bit value
-        if(data->temperature & 0x800) {
-          data->temperature |= 0xF000;
-        }
-        retval = true;
-      }
-      // Checksum error
-      else {
-//        printf("Checksum error\n");
-      }
-    }
-
-
-    // Increment bit pointer
-    bitNr++;
-    // But not more than 36 Bits
-    if(bitNr > 35) {
-      bitNr = 0;
-    }
-  } while(reCheck);
-
-  exit:
-  return retval;
-}
-
-/***********************************************************************************************************************
- * Check if two messages are equal
- **********************************************************************************************************************/
-static bool AuriolIsMessageEqual(AuriolData *msg1, AuriolData *msg2)
-{
-  return(
-      (msg1->id          == msg2->id         ) &&
-      (msg1->battery     == msg2->battery    ) &&
-      (msg1->status      == msg2->status     ) &&
-      (msg1->button      == msg2->button     ) &&
-      (msg1->temperature == msg2->temperature) &&
-      (msg1->humidity    == msg2->humidity   ) &&
-      (msg1->checksum    == msg2->checksum   ) &&
-      // Messages can only be equal within the duplicate timeframe
-      ((msg1->timeStamp - msg2->timeStamp) < DUPLICATE_TIME)
-      );
-}
-
-/***********************************************************************************************************************
- * Process Bits for Auriol
- **********************************************************************************************************************/
-void AuriolProcess(uint32_t pulseLength)
-{
-  // Bit decoder context
-  static PulseSpaceContext bitDecoderCtx = {
-    .pulseMin = PULSE_LENGTH - TOLERANCE,
-    .pulseMax = PULSE_LENGTH + TOLERANCE,
-    .zeroMin  = ZERO_LENGTH  - TOLERANCE,
-    .zeroMax  = ZERO_LENGTH  + TOLERANCE,
-    .oneMin   = ONE_LENGTH   - TOLERANCE,
-    .oneMax   = ONE_LENGTH   + TOLERANCE,
-    .state = Idle,
-    .inStream = 0
-  };
-  // Decoded Auriol data and the previous one
-  static AuriolData data, prevData = { 0 };
-  // We will lock on one successful message duplicate
-  static bool lock = false;
-
-  // Auriol Messages
-  if(AuriolDecode(&data, DecodePulseSpace(&bitDecoderCtx, pulseLength))) {
-    // Check if actual and previous messages are equal
-    bool equal = AuriolIsMessageEqual(&data, &prevData);
-    // If messages are different
-    if(!equal) {
-      // Release lock
-      lock = false;
-    }
-    // Check for two successive duplicate messages
-    if(!lock && equal) {
-      // Set lock
-      lock = true;
-      // Convert temperature
-      double temperature = data.temperature / 10.0;
-      // And Print
-      printf("auriol %u %u %u %u %.1f %x\n",
-        data.id, data.battery, data.status, data.button, temperature, data.humidity);
-      fflush(stdout);
-    }
-    // Remember old message
-    prevData = data;
-  }
-}
+#include "auriol.h"
+
+// Bit decoder timing: pulse length, space length for bit ZERO and ONE, tolerance in us
+static const PulseSpaceTiming auriolTiming[TimingProfileCount] = {
+  [TimingDigital] = PULSE_SPACE_TIMING(500, 2000, 4000, 200),
+  // The Analog filter alters the pulse / space timings
+  [TimingAnalog]  = PULSE_SPACE_TIMING(662, 1780, 3850, 200)
+};
+
+// Auriol: 36 bits, every field sent LSB first, nibble sum checksum in the last 4 bits
+#define PROTOCOL_NAME             auriol
+#define PROTOCOL_BIT_DECODER      pulseSpaceBitDecoder
+#define PROTOCOL_TIMING           auriolTiming
+#define PROTOCOL_FRAME_LENGTH     36
+#define PROTOCOL_FIELDS(FIELD) \
+  FIELD(id,           0,  8, LSB_FIRST | KEY)    \
+  FIELD(battery,      8,  1, LSB_FIRST)          \
+  FIELD(status,       9,  2, LSB_FIRST)          \
+  FIELD(button,      11,  1, LSB_FIRST)          \
+  FIELD(temperature, 12, 12, LSB_FIRST | SIGNED) \
+  FIELD(humidity,    24,  8, LSB_FIRST)
+#define PROTOCOL_CHECKSUM         CHECKSUM_NIBBLE_SUM
+// Status 3 is not a measurement
+#define PROTOCOL_VALID(data)      ((data)->status != 3)
+#define PROTOCOL_OUTPUT(data)     "%d %d %d %d %.1f %x\n", \
+  (data)->id, (data)->battery, (data)->status, (data)->button, (data)->temperature / 10.0, (data)->humidity
+// Humidity is BCD coded
+#define PROTOCOL_RECORD(data, record) \
+  (record)->id = (data)->id; \
+  (record)->battery = (data)->battery ? BatteryLow : BatteryOk; \
+  OutputSet(record, QuantityTemperature, (data)->temperature); \
+  OutputSet(record, QuantityHumidity, (((data)->humidity >> 4) * 10) + ((data)->humidity & 0xF));
+#include "FrameProtocol.h"
 
 #endif // MODULE_AURIOL_ENABLE
@@ -32,17 +32,16 @@
  **********************************************************************************************************************/
 
 #ifndef AURIOL_H_
-#define AURIOLH_H_
+#define AURIOL_H_
 
 #include "config.h"
 #ifdef MODULE_AURIOL_ENABLE
 
-#include <stdint.h>
+#include "Protocol.h"
 
-void AuriolProcess(uint32_t pulseLength);
+// Protocol description
+extern const ProtocolType auriolProtocol;
 
-#else // MODULE_AURIOL_ENABLE
-#define AuriolProcess(x)
 #endif // MODULE_AURIOL_ENABLE
 
 #endif // AURIOL_H_
@@ -37,10 +37,10 @@
 // Default LIRC device file
 #define DEFAULT_LIRC_DEV  "/dev/lirc0"
 
-// Enable if signal is coming through the analog filter
+// Default timing profile: enable if signal is coming through the analog filter (see option -f)
 //#define ANALOG_FILTER
 
-// Decoder Modules
+// Decoder Modules compiled in
 #define MODULE_WT440H_ENABLE
 #define MODULE_AURIOL_ENABLE
 #define MODULE_RFTECH_ENABLE
@@ -48,6 +48,9 @@
 #define MODULE_WS1700_ENABLE
 #define MODULE_WS1700_VARIANT_WS1700
 #define MODULE_WS1700_VARIANT_GT_WT_01
-//#define MODULE_GT9000_ENABLE
+#define MODULE_GT9000_ENABLE
+
+// Protocols selected by default (see option -p)
+#define DEFAULT_PROTOCOLS "wt440h,auriol,mebus,rftech,ws1700,gtwt01"
 
 #endif // CONFIG_H_
@@ -32,77 +32,52 @@
  **********************************************************************************************************************/
 
 #include <stdbool.h>
-#include <string.h>
-#include <sys/time.h>
-#include <stdio.h>
 #include "gt9000.h"
 #include "types.h"
+#include "DecodeAutomaton.h"
 
 #ifdef MODULE_GT9000_ENABLE
 
-#ifndef ANALOG_FILTER
-#define START1_SHORT_LEN       400
-#define START1_LONG_LEN       2300
-#define START2_SHORT_LEN      3000
-#define START2_LONG_LEN       7200
-#define SHORT_LEN              400
-#define LONG_LEN              1100
-#define TOLERANCE              200
-
-#define SHORT_LENGTH_MIN      (SHORT_LEN - TOLERANCE)
-#define SHORT_LENGTH_MAX      (SHORT_LEN + TOLERANCE)
-#define LONG_LENGTH_MIN       (LONG_LEN - TOLERANCE)
-#define LONG_LENGTH_MAX       (LONG_LEN + TOLERANCE)
-
-#else // ANALOG_FILTER
-#define START1_SHORT_LEN       600
-#define START1_LONG_LEN       2050
-#define START2_SHORT_LEN      3260
-#define START2_LONG_LEN       6920
+// Bit decoder timing
+typedef struct {
+  // Halves of the data bits
+  AutomatonWindowType shortHalf;
+  AutomatonWindowType longHalf;
+  // Start bit 1
+  AutomatonWindowType start1Short;
+  AutomatonWindowType start1Long;
+  // Start bit 2
+  AutomatonWindowType start2Short;
+  AutomatonWindowType start2Long;
+} GT9000Timing;
+
+// Window around a nominal length
 #define TOLERANCE              200
-
-#define SHORT_LENGTH_MIN       100
-#define SHORT_LENGTH_MAX       700
-#define LONG_LENGTH_MIN        800
-#define LONG_LENGTH_MAX       1500
-
-#endif // ANALOG_FILTER
-
-#define START1_SHORT_LEN_MIN  (START1_SHORT_LEN - TOLERANCE)
-#define START1_SHORT_LEN_MAX  (START1_SHORT_LEN + TOLERANCE)
-#define START1_LONG_LEN_MIN   (START1_LONG_LEN - TOLERANCE)
-#define START1_LONG_LEN_MAX   (START1_LONG_LEN + TOLERANCE)
-
-#define START2_SHORT_LEN_MIN  (START2_SHORT_LEN - TOLERANCE)
-#define START2_SHORT_LEN_MAX  (START2_SHORT_LEN + TOLERANCE)
-#define START2_LONG_LEN_MIN   (START2_LONG_LEN - TOLERANCE)
-#define START2_LONG_LEN_MAX   (START2_LONG_LEN + TOLERANCE)
-
-#define MIN_LENGTH            SHORT_LENGTH_MIN
-
-// Pulse length check macros
-#define IS_PULSE_SHORT(length)  ((length >= SHORT_LENGTH_MIN) && (length <= SHORT_LENGTH_MAX))
-#define IS_PULSE_LONG(length)   ((length >= LONG_LENGTH_MIN) && (length <= LONG_LENGTH_MAX))
-// Start 1
-#define IS_START1_SHORT(length) ((length >= START1_SHORT_LEN_MIN) && (length <= START1_SHORT_LEN_MAX))
-#define IS_START1_LONG(length)  ((length >= START1_LONG_LEN_MIN) && (length <= START1_LONG_LEN_MAX))
-// Start 2
-#define IS_START2_SHORT(length) ((length >= START2_SHORT_LEN_MIN) && (length <= START2_SHORT_LEN_MAX))
-#define IS_START2_LONG(length)  ((length >= START2_LONG_LEN_MIN) && (length <= START2_LONG_LEN_MAX))
-
-// Search for identical messages within this timeframe in uS
-#define DUPLICATE_TIME     1000000
+#define WINDOW(length)         { (length) - TOLERANCE, (length) + TOLERANCE }
+
+// Bit decoder timing per profile
+static const GT9000Timing gt9000Timing[TimingProfileCount] = {
+  [TimingDigital] = {
+    .shortHalf   = WINDOW(400),
+    .longHalf    = WINDOW(1100),
+    .start1Short = WINDOW(400),
+    .start1Long  = WINDOW(2300),
+    .start2Short = WINDOW(3000),
+    .start2Long  = WINDOW(7200)
+  },
+  [TimingAnalog] = {
+    .shortHalf   = { 100, 700 },
+    .longHalf    = { 800, 1500 },
+    .start1Short = WINDOW(600),
+    .start1Long  = WINDOW(2050),
+    .start2Short = WINDOW(3260),
+    .start2Long  = WINDOW(6920)
+  }
+};
 
 // Invalid channel
 #define CH_INVALID    255
 
-// Decoded data
-typedef struct {
-  uint8_t channel;
-  uint16_t code;
-  uint32_t timeStamp;
-} GT9000Data;
-
 // Code Groups
 typedef enum {
   CodeGroupA = 0,
@@ -116,229 +91,86 @@ typedef enum {
   Invalid
 } StateType;
 
-/***********************************************************************************************************************
- * Bit Decoder
- **********************************************************************************************************************/
-static BitType GT9000BitDecode(uint32_t pulseLength)
-{
-  // Internal State
-  static enum {
-    Idle,
-    Start1ShortReceived,
-    Start1LongReceived,
-    Start2ShortReceived,
-    Start2LongReceived,
-    BitReception,
-    HalfZeroReceived,
-    HalfOneReceived
-  } state = Idle;
-  // Are bits in a stream (no interruptions between)
-  static BitType inStream = 0;
-  // Return Value
-  BitType bit = 0;
-  // Recheck bit
-  bool again = false;
-
-  // Low pass filter
-  if(pulseLength < MIN_LENGTH) {
-    goto exit;
-  }
-
-  do {
-    // Only recheck once
-    again = false;
-    // Bit reception state machine
-    switch(state) {
-      // No Start Mark received yet
-      case Idle: {
-        inStream = 0;
-        // Start Mark 1
-        if(IS_START1_SHORT(pulseLength)) {
-          state = Start1ShortReceived;
-        }
-        // Start Mark 2
-        else if(IS_START2_SHORT(pulseLength)) {
-          state = Start2ShortReceived;
-        }
-        // else we stay in this state
-      }
-      break;
-
-      // First pulse of start 1 bit received
-      case Start1ShortReceived: {
-        if(IS_START1_LONG(pulseLength)) {
-          // Valid start bit received
-          state = BitReception;
-        }
-        else {
-          state = Idle;
-          again = true;
-        }
-      }
-      break;
-
-      // First pulse of start 2 bit received
-      case Start2ShortReceived: {
-        if(IS_START2_LONG(pulseLength)) {
-          // Valid start bit received
-          state = BitReception;
-        }
-        else {
-          state = Idle;
-          again = true;
-        }
-      }
-      break;
-
-      // Start bit received, bit reception state
-      case BitReception: {
-        // First half of a Zero
-        if(IS_PULSE_SHORT(pulseLength)) {
-          state = HalfZeroReceived;
-        }
-        // First half of a One
-        else if(IS_PULSE_LONG(pulseLength)) {
-          state = HalfOneReceived;
-        }
-        else {
-          state = Idle;
-          again = true;
-        }
-      }
-      break;
-
-      // First half of a Zero received
-      case HalfZeroReceived: {
-        if(IS_PULSE_LONG(pulseLength)) {
-          bit = BIT_ZERO | BIT_VALID | inStream;
-          inStream = BIT_IN_STREAM;
-          state = BitReception;
-        }
-        else {
-          // Here we don't go to idle state, since the first half of a zero could be the first half of a type 1 start
-          // bit, so we recheck it.
-          state = Start1ShortReceived;
-          inStream = 0;
-          again = true;
-        }
-      }
-      break;
-
-      // First half of a One received
-      case HalfOneReceived: {
-        if(IS_PULSE_SHORT(pulseLength)) {
-          bit = BIT_ONE | BIT_VALID | inStream;
-          inStream = BIT_IN_STREAM;
-          state = BitReception;
-        }
-        else {
-          state = Idle;
-          again = true;
-        }
-      }
-      break;
-
-      // Invalid state (should not happen)
-      default: {
-        state = Idle;
-      }
-      break;
-    }
-  } while(again == true);
-
-  exit:
-  return bit;
-}
+// Bit decoder states
+enum {
+  GT9000Idle,
+  GT9000Start1ShortReceived,
+  GT9000Start2ShortReceived,
+  GT9000BitReception,
+  GT9000HalfZeroReceived,
+  GT9000HalfOneReceived,
+  GT9000StateCount
+};
+
+// Length windows
+enum {
+  GT9000Short,
+  GT9000Long,
+  GT9000Start1Short,
+  GT9000Start1Long,
+  GT9000Start2Short,
+  GT9000Start2Long,
+  GT9000WindowCount
+};
+
+// Bit decoder: one of two start bits, then zeros (short mark, long space) and ones (long mark, short space). A pulse
+// not fitting the actual state is checked again in the idle state.
+static const AutomatonRuleType gt9000BitRules[] = {
+  // No Start Mark received yet
+  { GT9000Idle,                AUTOMATON_MARK,  GT9000Start1Short,    GT9000Start1ShortReceived, AUTOMATON_END },
+  { GT9000Idle,                AUTOMATON_MARK,  GT9000Start2Short,    GT9000Start2ShortReceived, AUTOMATON_END },
+  { GT9000Idle,                AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, GT9000Idle,                AUTOMATON_END },
+  // First pulse of start 1 bit received
+  { GT9000Start1ShortReceived, AUTOMATON_SPACE, GT9000Start1Long,     GT9000BitReception,        AUTOMATON_KEEP },
+  { GT9000Start1ShortReceived, AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, GT9000Idle,                AUTOMATON_AGAIN },
+  // First pulse of start 2 bit received
+  { GT9000Start2ShortReceived, AUTOMATON_SPACE, GT9000Start2Long,     GT9000BitReception,        AUTOMATON_KEEP },
+  { GT9000Start2ShortReceived, AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, GT9000Idle,                AUTOMATON_AGAIN },
+  // Start bit received, first half of a zero or a one
+  { GT9000BitReception,        AUTOMATON_MARK,  GT9000Short,          GT9000HalfZeroReceived,    AUTOMATON_KEEP },
+  { GT9000BitReception,        AUTOMATON_MARK,  GT9000Long,           GT9000HalfOneReceived,     AUTOMATON_KEEP },
+  { GT9000BitReception,        AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, GT9000Idle,                AUTOMATON_AGAIN },
+  // First half of a zero received. Otherwise it could have been the first half of a type 1 start bit, so the pulse is
+  // checked again there.
+  { GT9000HalfZeroReceived,    AUTOMATON_SPACE, GT9000Long,           GT9000BitReception,        AUTOMATON_ZERO },
+  { GT9000HalfZeroReceived,    AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, GT9000Start1ShortReceived,
+    AUTOMATON_END | AUTOMATON_AGAIN },
+  // First half of a one received
+  { GT9000HalfOneReceived,     AUTOMATON_SPACE, GT9000Short,          GT9000BitReception,        AUTOMATON_ONE },
+  { GT9000HalfOneReceived,     AUTOMATON_ANY,   AUTOMATON_ANY_LENGTH, GT9000Idle,                AUTOMATON_AGAIN }
+};
+
+static const AutomatonType gt9000BitAutomaton = {
+  .stateCount = GT9000StateCount,
+  .windowCount = GT9000WindowCount,
+  .rules = gt9000BitRules,
+  .ruleCount = sizeof(gt9000BitRules) / sizeof(gt9000BitRules[0])
+};
 
 /***********************************************************************************************************************
- * Message Decoder
+ * Initialize bit decoder context
  **********************************************************************************************************************/
-static bool GT9000Decode(GT9000Data *data, BitType bit)
+static void GT9000BitInit(void *context, const void *timing)
 {
-  // Preamble bits
-  static const uint8_t preamble[] = {1, 1, 0, 0};
-  // Bit number counter
-  static uint8_t bitNr = 0;
-  // Return value
-  bool retval = false;
-  // Recheck some bits
-  bool reCheck;
-
-  // Only process valid bits
-  if(!(bit & BIT_VALID)) {
-    goto exit;
-  }
-
-  do {
-    // Only Recheck once
-    reCheck = false;
-
-    // Clear all data at the beginning
-    if(bitNr == 0) {
-      memset(data, 0, sizeof(GT9000Data));
-    }
-    else {
-      // All bits except the first must be in a bit stream
-      if(!(bit & BIT_IN_STREAM)) {
-//        printf("Bit not in stream: %u\n", bitNr);
-        bitNr = 0;
-        // Check again this bit, maybe it's the start of a new telegram
-        reCheck = true;
-        continue;
-      }
-    }
-    // Remove flags
-    bit &= BIT_ONE;
-
-    // Preamble [0 .. 3]
-    if(bitNr <= 3) {
-      if(bit != preamble[bitNr]) {
-        //      printf("Wrong preamble %u at bit %u\n", bit, bitNr);
-        bitNr = 0;
-        goto exit;
-      }
-    }
-    // Code [4 .. 19]
-    else if((bitNr >= 4) && (bitNr <= 19)) {
-      data->code = (data->code << 1) | bit;
-    }
-    // Channel [20 .. 22]
-    else if((bitNr >= 20) && (bitNr <= 22)) {
-      data->channel = (data->channel << 1) | bit;
-    }
-
-    // Check if we have received everything
-    if(bitNr == 22) {
-      // Record reception Timestamp
-      struct timeval tv;
-      gettimeofday(&tv, NULL);
-      data->timeStamp = (tv.tv_sec * 1000000) + tv.tv_usec;
-      retval = true;
-    }
-
-    // Increment bit pointer
-    bitNr++;
-    // But not more than 24 Bits
-    if(bitNr > 23) {
-      bitNr = 0;
-    }
-  } while(reCheck);
+  const GT9000Timing *t = timing;
+  const AutomatonWindowType windows[GT9000WindowCount] = {
+    [GT9000Short]       = t->shortHalf,
+    [GT9000Long]        = t->longHalf,
+    [GT9000Start1Short] = t->start1Short,
+    [GT9000Start1Long]  = t->start1Long,
+    [GT9000Start2Short] = t->start2Short,
+    [GT9000Start2Long]  = t->start2Long
+  };
 
-  exit:
-  return retval;
+  AutomatonInit(context, &gt9000BitAutomaton, windows, t->shortHalf.min);
 }
 
 /***********************************************************************************************************************
- * Check if two messages are equal
+ * Bit Decoder
  **********************************************************************************************************************/
-static bool GT9000IsMessageEqual(GT9000Data *msg1, GT9000Data *msg2)
+static BitType GT9000BitDecode(void *context, const PulseType *pulse)
 {
-  return(
-      (msg1->channel == msg2->channel) &&
-      (msg1->code    == msg2->code   ) &&
-      // Messages can only be equal within the duplicate timeframe
-      ((msg1->timeStamp - msg2->timeStamp) < DUPLICATE_TIME)
-  );
+  return AutomatonDecode(context, pulse);
 }
 
 /***********************************************************************************************************************
@@ -403,37 +235,36 @@ static StateType GT9000MapCodeToFunction(uint8_t channel, uint16_t code)
 }
 
 /***********************************************************************************************************************
- * Process Messages
+ * Bit decoder description
  **********************************************************************************************************************/
-void GT9000Process(uint32_t lircData)
-{
-  // Decoded data and the previous one
-  static GT9000Data data, prevData = { 0 };
-  // We will lock on one successful message duplicate
-  static bool lock = false;
-
-  // Decode Messages
-  if(GT9000Decode(&data, GT9000BitDecode(lircData))) {
-    // Check if actual and previous messages are equal
-    bool equal = GT9000IsMessageEqual(&data, &prevData);
-    // If messages are different
-    if(!equal) {
-      // Release lock
-      lock = false;
-    }
-    // Check for two successive duplicate messages
-    if(!lock && equal) {
-      // Convert Channel
-      uint8_t channel = GT9000convertChannel(data.channel);
-      // Set lock
-      lock = true;
-      // Print
-      printf("gt9000 %u %u \n",channel, GT9000MapCodeToFunction(channel, data.code));
-      fflush(stdout);
-    }
-    // Remember old message
-    prevData = data;
+static const BitDecoderType gt9000BitDecoder = {
+  .contextSize = sizeof(AutomatonContext),
+  .timingSize = sizeof(GT9000Timing),
+  .init = GT9000BitInit,
+  .decode = GT9000BitDecode
+};
+
+// GT-9000: 23 bits, MSB first, preamble "1100", a trailing bit is tolerated
+#define PROTOCOL_NAME             gt9000
+#define PROTOCOL_BIT_DECODER      gt9000BitDecoder
+#define PROTOCOL_TIMING           gt9000Timing
+#define PROTOCOL_FRAME_LENGTH     23
+#define PROTOCOL_FRAME_LENGTH_MAX 24
+#define PROTOCOL_PREAMBLE_LENGTH  4
+#define PROTOCOL_PREAMBLE         0xC
+#define PROTOCOL_FIELDS(FIELD) \
+  FIELD(code,     4, 16, MSB_FIRST | KEY) \
+  FIELD(channel, 20,  3, MSB_FIRST | KEY)
+#define PROTOCOL_OUTPUT(data)     "%d %d \n", GT9000convertChannel((data)->channel), \
+  GT9000MapCodeToFunction(GT9000convertChannel((data)->channel), (data)->code)
+#define PROTOCOL_RECORD(data, record) \
+  (record)->id = (data)->code; \
+  (record)->channel = (GT9000convertChannel((data)->channel) != CH_INVALID) ? \
+    GT9000convertChannel((data)->channel) : -1; \
+  if(GT9000MapCodeToFunction(GT9000convertChannel((data)->channel), (data)->code) != Invalid) { \
+    OutputSet(record, QuantitySwitch, GT9000MapCodeToFunction(GT9000convertChannel((data)->channel), (data)->code)); \
   }
-}
+#include "FrameProtocol.h"
+
 
 #endif // MODULE_GT9000_ENABLE
@@ -37,12 +37,11 @@
 #include "config.h"
 #ifdef MODULE_GT9000_ENABLE
 
-#include <stdint.h>
+#include "Protocol.h"
 
-void GT9000Process(uint32_t lircData);
+// Protocol description
+extern const ProtocolType gt9000Protocol;
 
-#else // MODULE_GT9000_ENABLE
-#define GT9000Process(x)
 #endif // MODULE_GT9000_ENABLE
 
 #endif // GT9000_H_
@@ -34,186 +34,34 @@
 #include "config.h"
 #ifdef MODULE_MEBUS_ENABLE
 
-#include <stdio.h>
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <sys/time.h>
-#include "types.h"
 #include "DecodePulseSpace.h"
-
-#ifndef ANALOG_FILTER
-
-// Pulse length in us
-#define PULSE_LENGTH       500
-// Space length for bit ZERO in us
-#define ZERO_LENGTH       1000
-// Space length for bit ONE in us
-#define ONE_LENGTH        2000
-
-#else // ANALOG_FILTER
-// The Analog filter alters the pulse / space timings
-
-// Pulse length in us
-#define PULSE_LENGTH       662
-// Space length for bit ZERO in us
-#define ZERO_LENGTH        780
-// Space length for bit ONE in us
-#define ONE_LENGTH        1850
-
-#endif // ANALOG_FILTER
-
-// Signal timing tolerance
-#define TOLERANCE          200
-
-// Search for identical messages within this timeframe in uS
-#define DUPLICATE_TIME     1000000
-
-// Decoded data
-typedef struct {
-  uint8_t id;
-  uint8_t status;
-  uint16_t temperature;
-  uint8_t humidity;
-  uint32_t timeStamp;
-} MebusData;
-
-/***********************************************************************************************************************
- * Mebus Message Decoder
- **********************************************************************************************************************/
-static bool MebusDecode(MebusData *data, BitType bit)
-{
-  // Bit number counter
-  static uint8_t bitNr = 0;
-  // Return value
-  bool retval = false;
-  // Recheck some bits
-  bool reCheck;
-
-  // Only process valid bits
-  if(!(bit & BIT_VALID)) {
-    goto exit;
-  }
-
-  do {
-    // Only Recheck once
-    reCheck = false;
-
-    // Clear all data at the beginning
-    if(bitNr == 0) {
-      memset(data, 0, sizeof(MebusData));
-    }
-    else {
-      // All bits except the first must be in a bit stream
-      if(!(bit & BIT_IN_STREAM)) {
-//        printf("Bit not in stream: %u\n", bitNr);
-        bitNr = 0;
-        // Check again this bit, maybe it's the start of a new telegram
-        reCheck = true;
-        continue;
-      }
-    }
-    // Remove flags
-    bit &= BIT_ONE;
-
-    // ID [0 .. 13]
-    if(bitNr <= 13) {
-      data->id = (data->id << 1) | bit;
-    }
-    // Temperature [14 .. 23]
-    else if((bitNr >= 14) && (bitNr <= 23)) {
-      data->temperature = (data->temperature << 1) | bit;
-    }
-    // Status [24 .. 28]
-    else if((bitNr >= 24) && (bitNr <= 28)) {
-      data->status = (data->status << 1) | bit;
-    }
-    // Humidity [29..35]
-    else if((bitNr >= 29) && (bitNr <= 35)) {
-      data->humidity = (data->humidity << 1) | bit;
-    }
-
-    // Check if we have received everything
-    if(bitNr == 35) {
-      // Record reception Timestamp
-      struct timeval tv;
-      gettimeofday(&tv, NULL);
-      data->timeStamp = (tv.tv_sec * 1000000) + tv.tv_usec;
-      retval = true;
-    }
-
-
-    // Increment bit pointer
-    bitNr++;
-    // But not more than 36 Bits
-    if(bitNr > 36) {
-      bitNr = 0;
-    }
-  } while(reCheck);
-
-  exit:
-  return retval;
-}
-
-/***********************************************************************************************************************
- * Check if two messages are equal
- **********************************************************************************************************************/
-static bool MebusIsMessageEqual(MebusData *msg1, MebusData *msg2)
-{
-  return(
-      (msg1->id          == msg2->id         ) &&
-      (msg1->status      == msg2->status     ) &&
-      (msg1->temperature == msg2->temperature) &&
-      (msg1->humidity    == msg2->humidity   ) &&
-      // Messages can only be equal within the duplicate timeframe
-      ((msg1->timeStamp - msg2->timeStamp) < DUPLICATE_TIME)
-      );
-}
-
-/***********************************************************************************************************************
- * Process Bits for Mebus YD8220B
- **********************************************************************************************************************/
-void MebusProcess(uint32_t pulseLength)
-{
-  // Bit decoder context
-  static PulseSpaceContext bitDecoderCtx = {
-    .pulseMin = PULSE_LENGTH - TOLERANCE,
-    .pulseMax = PULSE_LENGTH + TOLERANCE,
-    .zeroMin  = ZERO_LENGTH  - TOLERANCE,
-    .zeroMax  = ZERO_LENGTH  + TOLERANCE,
-    .oneMin   = ONE_LENGTH   - TOLERANCE,
-    .oneMax   = ONE_LENGTH   + TOLERANCE,
-    .state = Idle,
-    .inStream = 0
-  };
-  // Decoded data and the previous one
-  static MebusData data, prevData = { 0 };
-  // We will lock on one successful message duplicate
-  static bool lock = false;
-
-  // Decode Messages
-  if(MebusDecode(&data, DecodePulseSpace(&bitDecoderCtx, pulseLength))) {
-    // Check if actual and previous messages are equal
-    bool equal = MebusIsMessageEqual(&data, &prevData);
-    // If messages are different
-    if(!equal) {
-      // Release lock
-      lock = false;
-    }
-    // Check for two successive duplicate messages
-    if(!lock && equal) {
-      // Set lock
-      lock = true;
-      // Convert temperature
-      double temperature;
-      temperature = data.temperature / 10.0;
-      // And Print
-      printf("mebus %u %u %.1f %u\n",data.id, data.status, temperature, data.humidity);
-      fflush(stdout);
-    }
-    // Remember old message
-    prevData = data;
-  }
-}
+#include "mebus.h"
+
+// Bit decoder timing: pulse length, space length for bit ZERO and ONE, tolerance in us
+static const PulseSpaceTiming mebusTiming[TimingProfileCount] = {
+  [TimingDigital] = PULSE_SPACE_TIMING(500, 1000, 2000, 200),
+  // The Analog filter alters the pulse / space timings
+  [TimingAnalog]  = PULSE_SPACE_TIMING(662,  780, 1850, 200)
+};
+
+// Mebus: 36 bits, MSB first, one more trailing bit is tolerated
+#define PROTOCOL_NAME             mebus
+#define PROTOCOL_BIT_DECODER      pulseSpaceBitDecoder
+#define PROTOCOL_TIMING           mebusTiming
+#define PROTOCOL_FRAME_LENGTH     36
+#define PROTOCOL_FRAME_LENGTH_MAX 37
+#define PROTOCOL_FIELDS(FIELD) \
+  FIELD(id,           0, 14, MSB_FIRST | KEY) \
+  FIELD(temperature, 14, 10, MSB_FIRST)       \
+  FIELD(status,      24,  5, MSB_FIRST)       \
+  FIELD(humidity,    29,  7, MSB_FIRST)
+// Only the lower 8 bits of the ID are printed
+#define PROTOCOL_OUTPUT(data)     "%d %d %.1f %d\n", \
+  (data)->id & 0xFF, (data)->status, (data)->temperature / 10.0, (data)->humidity
+#define PROTOCOL_RECORD(data, record) \
+  (record)->id = (data)->id & 0xFF; \
+  OutputSet(record, QuantityTemperature, (data)->temperature); \
+  OutputSet(record, QuantityHumidity, (data)->humidity);
+#include "FrameProtocol.h"
 
 #endif // MODULE_MEBUS_ENABLE
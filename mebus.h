@@ -37,12 +37,11 @@
 #include "config.h"
 #ifdef MODULE_MEBUS_ENABLE
 
-#include "types.h"
+#include "Protocol.h"
 
-void MebusProcess(uint32_t pulseLength);
+// Protocol description
+extern const ProtocolType mebusProtocol;
 
-#else // MODULE_MEBUS_ENABLE
-#define MebusProcess(x)
 #endif // MODULE_MEBUS_ENABLE
 
 #endif // MEBUS_H_
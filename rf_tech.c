@@ -34,189 +34,35 @@
 #include "config.h"
 #ifdef MODULE_RFTECH_ENABLE
 
-#include <stdio.h>
-#include <stdint.h>
-#include <stdbool.h>
-#include <string.h>
-#include <sys/time.h>
-#include "types.h"
 #include "DecodePulseSpace.h"
+#include "rf_tech.h"
 
-#ifndef ANALOG_FILTER
-
-// Pulse length in us
-#define PULSE_LENGTH       500
-// Space length for bit ZERO in us
-#define ZERO_LENGTH       2000
-// Space length for bit ONE in us
-#define ONE_LENGTH        4000
-
-#else // ANALOG_FILTER
-// The Analog filter alters the pulse / space timings
-
-// Pulse length in us
-#define PULSE_LENGTH       662
-// Space length for bit ZERO in us
-#define ZERO_LENGTH       1780
-// Space length for bit ONE in us
-#define ONE_LENGTH        3850
-
-#endif // ANALOG_FILTER
-
-// Signal timing tolerance
-#define TOLERANCE          200
-
-// Search for identical messages within this timeframe in uS
-#define DUPLICATE_TIME     1000000
-
-// Decoded data
-typedef struct {
-  uint8_t id;
-  uint8_t status;
-  uint8_t temperatureInteger;
-  uint8_t temperatureFraction;
-  uint32_t timeStamp;
-} RFTechData;
 // Temperature Sign bit
 #define TEMP_SIGN_BIT      (1 << 7)
 
-/***********************************************************************************************************************
- * RF-Tech Message Decoder
- **********************************************************************************************************************/
-static bool RFTechDecode(RFTechData *data, BitType bit)
-{
-  // Bit number counter
-  static uint8_t bitNr = 0;
-  // Return value
-  bool retval = false;
-  // Recheck some bits
-  bool reCheck;
-
-  // Only process valid bits
-  if(!(bit & BIT_VALID)) {
-    goto exit;
-  }
-
-  do {
-    // Only Recheck once
-    reCheck = false;
-
-    // Clear all data at the beginning
-    if(bitNr == 0) {
-      memset(data, 0, sizeof(RFTechData));
-    }
-    else {
-      // All bits except the first must be in a bit stream
-      if(!(bit & BIT_IN_STREAM)) {
-//        printf("Bit not in stream: %u\n", bitNr);
-        bitNr = 0;
-        // Check again this bit, maybe it's the start of a new telegram
-        reCheck = true;
-        continue;
-      }
-    }
-    // Remove flags
-    bit &= BIT_ONE;
-
-    // ID [0 .. 7]
-    if(bitNr <= 7) {
-      data->id = (data->id << 1) | bit;
-    }
-    // Temperature Integer Part [8 .. 15]
-    else if((bitNr >= 8) && (bitNr <= 15)) {
-      data->temperatureInteger = (data->temperatureInteger << 1) | bit;
-    }
-    // Status [16 .. 19]
-    else if((bitNr >= 16) && (bitNr <= 19)) {
-      data->status = (data->status << 1) | bit;
-    }
-    // Temperature Fraction Part [20 .. 23]
-    else if((bitNr >= 20) && (bitNr <= 23)) {
-      data->temperatureFraction = (data->temperatureFraction << 1) | bit;
-    }
-
-    // Check if we have received everything
-    if(bitNr == 23) {
-      // Record reception Timestamp
-      struct timeval tv;
-      gettimeofday(&tv, NULL);
-      data->timeStamp = (tv.tv_sec * 1000000) + tv.tv_usec;
-      retval = true;
-    }
-
-
-    // Increment bit pointer
-    bitNr++;
-    // But not more than 36 Bits
-    if(bitNr > 23) {
-      bitNr = 0;
-    }
-  } while(reCheck);
-
-  exit:
-  return retval;
-}
-
-/***********************************************************************************************************************
- * Check if two messages are equal
- **********************************************************************************************************************/
-static bool RFTechIsMessageEqual(RFTechData *msg1, RFTechData *msg2)
-{
-  return(
-      (msg1->id                  == msg2->id         )         &&
-      (msg1->status              == msg2->status     )         &&
-      (msg1->temperatureInteger  == msg2->temperatureInteger)  &&
-      (msg1->temperatureFraction == msg2->temperatureFraction) &&
-      // Messages can only be equal within the duplicate timeframe
-      ((msg1->timeStamp - msg2->timeStamp) < DUPLICATE_TIME)
-      );
-}
-
-/***********************************************************************************************************************
- * Process Bits for Auriol
- **********************************************************************************************************************/
-void RFTechProcess(uint32_t pulseLength)
-{
-  // Bit decoder context
-  static PulseSpaceContext bitDecoderCtx = {
-    .pulseMin = PULSE_LENGTH - TOLERANCE,
-    .pulseMax = PULSE_LENGTH + TOLERANCE,
-    .zeroMin  = ZERO_LENGTH  - TOLERANCE,
-    .zeroMax  = ZERO_LENGTH  + TOLERANCE,
-    .oneMin   = ONE_LENGTH   - TOLERANCE,
-    .oneMax   = ONE_LENGTH   + TOLERANCE,
-    .state = Idle,
-    .inStream = 0
-  };
-  // Decoded data and the previous one
-  static RFTechData data, prevData = { 0 };
-  // We will lock on one successful message duplicate
-  static bool lock = false;
-
-  // Decode Messages
-  if(RFTechDecode(&data, DecodePulseSpace(&bitDecoderCtx, pulseLength))) {
-    // Check if actual and previous messages are equal
-    bool equal = RFTechIsMessageEqual(&data, &prevData);
-    // If messages are different
-    if(!equal) {
-      // Release lock
-      lock = false;
-    }
-    // Check for two successive duplicate messages
-    if(!lock && equal) {
-      // Set lock
-      lock = true;
-      // Convert temperature
-      double temperature;
-      temperature = data.temperatureInteger & (~TEMP_SIGN_BIT);
-      temperature += data.temperatureFraction / 10.0;
-      // And Print
-      printf("rftech %u %u %.1f\n",data.id, data.status, temperature);
-      fflush(stdout);
-    }
-    // Remember old message
-    prevData = data;
-  }
-}
+// Bit decoder timing: pulse length, space length for bit ZERO and ONE, tolerance in us
+static const PulseSpaceTiming rftechTiming[TimingProfileCount] = {
+  [TimingDigital] = PULSE_SPACE_TIMING(500, 2000, 4000, 200),
+  // The Analog filter alters the pulse / space timings
+  [TimingAnalog]  = PULSE_SPACE_TIMING(662, 1780, 3850, 200)
+};
+
+// RF-Tech: 24 bits, MSB first
+#define PROTOCOL_NAME             rftech
+#define PROTOCOL_BIT_DECODER      pulseSpaceBitDecoder
+#define PROTOCOL_TIMING           rftechTiming
+#define PROTOCOL_FRAME_LENGTH     24
+#define PROTOCOL_FIELDS(FIELD) \
+  FIELD(id,                   0, 8, MSB_FIRST | KEY) \
+  FIELD(temperatureInteger,   8, 8, MSB_FIRST)       \
+  FIELD(status,              16, 4, MSB_FIRST)       \
+  FIELD(temperatureFraction, 20, 4, MSB_FIRST)
+#define PROTOCOL_OUTPUT(data)     "%d %d %.1f\n", (data)->id, (data)->status, \
+  ((data)->temperatureInteger & ~TEMP_SIGN_BIT) + (data)->temperatureFraction / 10.0
+#define PROTOCOL_RECORD(data, record) \
+  (record)->id = (data)->id; \
+  OutputSet(record, QuantityTemperature, (((data)->temperatureInteger & TEMP_SIGN_BIT) ? -1 : 1) * \
+    ((((data)->temperatureInteger & ~TEMP_SIGN_BIT) * 10) + (data)->temperatureFraction));
+#include "FrameProtocol.h"
 
 #endif // MODULE_RFTECH_ENABLE
@@ -37,12 +37,11 @@
 #include "config.h"
 #ifdef MODULE_RFTECH_ENABLE
 
-#include "types.h"
+#include "Protocol.h"
 
-void RFTechProcess(uint32_t pulseLength);
+// Protocol description
+extern const ProtocolType rftechProtocol;
 
-#else // MODULE_RFTECH_ENABLE
-#define RFTechProcess(x)
 #endif // MODULE_RFTECH_ENABLE
 
 #endif // RFTECH_H_
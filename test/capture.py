@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+#
+# Synthetic lirc captures for replay (weather_rx -r): raw 32 bit mode2 samples in host order
+#
+#   capture.py sensors FILE [REPEATS]   One frame of every protocol, each sent three times, REPEATS rounds
+#   capture.py prefixed FILE [REPEATS]  The same with three random bits before every frame
+#   capture.py burst FILE [REPEATS]     The same with the three copies sent back to back without a break
+#   capture.py carrier FILE [REPEATS]   The same with a carrier frequency report after every pulse
+#   capture.py noise FILE [SEED]        800000 random biphase half / full bit lengths, no frames at all
+#
+
+import random
+import struct
+import sys
+
+PULSE = 0x01000000
+FREQUENCY = 0x02000000
+
+samples = []
+carrier = False
+
+def pulse(length):
+  samples.append(PULSE | length)
+  if carrier:
+    samples.append(FREQUENCY | 38000)
+
+def space(length):
+  samples.append(length)
+
+def lsb(value, count):
+  return [(value >> i) & 1 for i in range(count)]
+
+def msb(value, count):
+  return [(value >> (count - 1 - i)) & 1 for i in range(count)]
+
+# Frame encodings
+def auriol(id, battery, status, button, temperature, humidity):
+  bits = lsb(id, 8) + [battery] + lsb(status, 2) + [button] + lsb(temperature & 0xFFF, 12) + lsb(humidity, 8)
+  total = sum(sum(bits[i * 4 + j] << j for j in range(4)) for i in range(8))
+  return bits + lsb((15 - total) & 0xF, 4)
+
+def ws1700(preamble, id, battery, tx, channel, temperature, humidity):
+  return msb(preamble, 4) + msb(id, 8) + [battery, tx] + msb(channel, 2) + msb(temperature & 0xFFF, 12) + \
+    msb(humidity, 8)
+
+def rftech(id, integer, status, fraction):
+  return msb(id, 8) + msb(integer, 8) + msb(status, 4) + msb(fraction, 4)
+
+def mebus(id, temperature, status, humidity):
+  return msb(id, 14) + msb(temperature, 10) + msb(status, 5) + msb(humidity, 7)
+
+def wt440h(house, channel, status, battery, humidity, integer, fraction, sequence):
+  bits = [1, 1, 0, 0] + msb(house, 4) + msb(channel, 2) + msb(status, 2) + [battery] + msb(humidity, 7) + \
+    msb(integer, 8) + msb(fraction, 4) + msb(sequence, 2)
+  return bits + [sum(bits[0::2]) & 1, sum(bits[1::2]) & 1]
+
+# Modulations
+def pulseSpace(bits, mark=500, zero=2000, one=4000):
+  pulse(mark)
+  space(9000)
+  for bit in bits:
+    pulse(mark)
+    space(one if bit else zero)
+  pulse(mark)
+  space(9000)
+
+def biphaseMark(bits):
+  space(20000)
+  level = True
+  for bit in bits:
+    for length in ([1000, 1000] if bit else [2000]):
+      if level:
+        pulse(length)
+      else:
+        space(length)
+      level = not level
+  space(20000)
+
+def sensors(repeats, prefix, burst):
+  frames = [
+    (pulseSpace, auriol(0x5A, 0, 0, 0, 215, 0x45)),
+    (pulseSpace, auriol(0x33, 1, 1, 0, -35, 0x60)),
+    (pulseSpace, ws1700(5, 0x21, 1, 0, 1, 223, 55)),
+    (pulseSpace, ws1700(9, 0x77, 0, 1, 2, -12, 80)),
+    (pulseSpace, rftech(0x42, 21, 0, 5)),
+    (lambda bits: pulseSpace(bits, 500, 1000, 2000), mebus(0x1234, 231, 3, 44)),
+    (biphaseMark, wt440h(5, 1, 0, 0, 47, 72, 8, 1))
+  ]
+  for round in range(repeats):
+    for modulation, bits in frames:
+      if burst:
+        modulation(bits * 3)
+      for copy in range(0 if burst else 3):
+        modulation([random.randint(0, 1) for i in range(prefix)] + bits)
+      space(1000000 + round)
+    space(3000000)
+
+def noise(count):
+  for i in range(count):
+    samples.append((PULSE if (i & 1) == 0 else 0) | random.choice((1000, 2000)))
+
+if len(sys.argv) < 3:
+  sys.exit("usage: capture.py sensors|prefixed|burst|carrier|noise FILE [REPEATS|SEED]")
+argument = int(sys.argv[3]) if len(sys.argv) > 3 else 1
+if sys.argv[1] == "noise":
+  random.seed(argument)
+  noise(800000)
+else:
+  random.seed(1)
+  carrier = (sys.argv[1] == "carrier")
+  sensors(argument, 3 if sys.argv[1] == "prefixed" else 0, sys.argv[1] == "burst")
+with open(sys.argv[2], "wb") as file:
+  file.write(struct.pack("=%dI" % len(samples), *samples))
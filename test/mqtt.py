@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+#
+# MQTT checks against a local mosquitto broker. weather_rx decodes the synthetic captures (see capture.py) from a FIFO
+# like from a lirc device and publishes to a broker started for the check on a free port, a small subscriber watches
+# the topics. Run from the repository root after make, or with "make check". Skipped without mosquitto, MOSQUITTO
+# selects the broker binary.
+#
+#   online        the session is accepted (CONNACK) and the status turns "online"
+#   readings      the readings of every protocol arrive on their topics (mqtt.txt)
+#   acknowledged  every QoS 1 publish is acknowledged (PUBACK), nothing is left queued
+#   retained      a subscriber coming later gets the readings and the status as retained messages
+#   reconnect     after a broker restart the client connects again and the readings arrive
+#   will          the status turns "offline" through the will when weather_rx dies
+#   keepalive     QoS 0 publishes with a short keep alive interval keep a single connection
+#
+
+import os
+import re
+import shutil
+import signal
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+TEST = os.path.dirname(os.path.abspath(__file__))
+WEATHER_RX = os.environ.get("WEATHER_RX", os.path.join(TEST, "..", "weather_rx"))
+MOSQUITTO = os.environ.get("MOSQUITTO") or shutil.which("mosquitto") or "/usr/sbin/mosquitto"
+PREFIX = "wrxtest"
+
+failed = False
+
+def check(name, ok, details=""):
+  global failed
+  print("%-5s %s%s" % ("ok" if ok else "FAIL", name, "" if ok or not details else ": " + details))
+  failed = failed or not ok
+
+def waitFor(condition, timeout):
+  end = time.monotonic() + timeout
+  while not condition():
+    if time.monotonic() > end:
+      return False
+    time.sleep(0.05)
+  return True
+
+def freePort():
+  with socket.socket() as probe:
+    probe.bind(("127.0.0.1", 0))
+    return probe.getsockname()[1]
+
+def connectable(port):
+  try:
+    socket.create_connection(("127.0.0.1", port), 1).close()
+    return True
+  except OSError:
+    return False
+
+# Minimal MQTT 3.1.1 packet coding
+def encodeString(string):
+  data = string.encode()
+  return struct.pack(">H", len(data)) + data
+
+def encodePacket(header, body):
+  length = bytearray()
+  remaining = len(body)
+  while True:
+    byte = remaining & 0x7F
+    remaining >>= 7
+    length.append(byte | (0x80 if remaining else 0))
+    if not remaining:
+      return bytes([header]) + bytes(length) + body
+
+def receiveExact(connection, count):
+  data = b""
+  while len(data) < count:
+    chunk = connection.recv(count - len(data))
+    if not chunk:
+      raise EOFError
+    data += chunk
+  return data
+
+def receivePacket(connection):
+  header = receiveExact(connection, 1)[0]
+  length, shift = 0, 0
+  while True:
+    byte = receiveExact(connection, 1)[0]
+    length |= (byte & 0x7F) << shift
+    shift += 7
+    if not byte & 0x80:
+      return header, receiveExact(connection, length)
+
+class Broker:
+  def __init__(self, work):
+    self.config = os.path.join(work, "mosquitto.conf")
+    self.port = freePort()
+    self.process = None
+    with open(self.config, "w") as file:
+      file.write("listener %d 127.0.0.1\nallow_anonymous true\npersistence false\n" % self.port)
+
+  def start(self):
+    self.process = subprocess.Popen([MOSQUITTO, "-c", self.config], stdout=subprocess.DEVNULL,
+      stderr=subprocess.DEVNULL)
+    if not waitFor(lambda: connectable(self.port), 5):
+      sys.exit("mosquitto did not start")
+
+  def stop(self):
+    if self.process is not None:
+      self.process.terminate()
+      self.process.wait()
+      self.process = None
+
+# Subscribes to all topics of the prefix and collects the messages as (topic, payload, retained)
+class Subscriber:
+  def __init__(self, port, client):
+    self.messages = []
+    self.lock = threading.Lock()
+    self.connection = socket.create_connection(("127.0.0.1", port), 5)
+    self.connection.sendall(encodePacket(0x10, encodeString("MQTT") + bytes([4, 0x02, 0, 60]) + encodeString(client)))
+    header, body = receivePacket(self.connection)
+    if (header != 0x20) or (body[1] != 0):
+      sys.exit("subscriber not accepted")
+    self.connection.sendall(encodePacket(0x82, struct.pack(">H", 1) + encodeString(PREFIX + "/#") + bytes([1])))
+    self.connection.settimeout(None)
+    threading.Thread(target=self.receive, daemon=True).start()
+
+  def receive(self):
+    try:
+      while True:
+        header, body = receivePacket(self.connection)
+        if (header & 0xF0) == 0x30:
+          length = struct.unpack(">H", body[:2])[0]
+          topic = body[2:2 + length].decode()
+          start = 2 + length
+          if header & 0x06:
+            self.connection.sendall(encodePacket(0x40, body[start:start + 2]))
+            start += 2
+          with self.lock:
+            self.messages.append((topic, body[start:].decode(), bool(header & 0x01)))
+    except (EOFError, OSError):
+      pass
+
+  def received(self, topic, payload, retained=None):
+    with self.lock:
+      return sum(1 for message in self.messages if (message[0] == PREFIX + "/" + topic) and
+        (message[1] == payload) and ((retained is None) or (message[2] == retained)))
+
+  def missing(self, expected, retained=None):
+    return [line for line in expected if not self.received(*line.split(" ", 1), retained=retained)]
+
+  def close(self):
+    self.connection.close()
+
+# weather_rx decoding from a FIFO, statistics are requested with SIGUSR1
+class Receiver:
+  def __init__(self, work, port, options):
+    self.fifo = os.path.join(work, "lirc")
+    if not os.path.exists(self.fifo):
+      os.mkfifo(self.fifo)
+    self.errors = os.path.join(work, "weather_rx.err")
+    with open(self.errors, "w") as errors:
+      self.process = subprocess.Popen([WEATHER_RX, "-o", "text", "-M",
+        "127.0.0.1:%d,prefix=%s,client=wrxtest,%s" % (port, PREFIX, options), self.fifo],
+        stdout=subprocess.DEVNULL, stderr=errors)
+    # Opening the FIFO waits for weather_rx, unless it failed to start
+    while True:
+      try:
+        descriptor = os.open(self.fifo, os.O_WRONLY | os.O_NONBLOCK)
+        break
+      except OSError:
+        if self.process.poll() is not None:
+          sys.exit("weather_rx did not start:\n" + self.output())
+        time.sleep(0.05)
+    os.set_blocking(descriptor, True)
+    self.input = os.fdopen(descriptor, "wb", buffering=0)
+
+  # The samples are written in real time like a receiver delivers them, the time stamps follow their arrival
+  def feed(self, capture):
+    samples = struct.unpack("=%dI" % (len(capture) // 4), capture)
+    start = time.monotonic()
+    duration = 0
+    for first in range(0, len(samples), 64):
+      chunk = samples[first:first + 64]
+      duration += sum(sample & 0xFFFFFF for sample in chunk) / 1e6
+      time.sleep(max(0, start + duration - time.monotonic()))
+      self.input.write(struct.pack("=%dI" % len(chunk), *chunk))
+
+  def output(self):
+    with open(self.errors) as errors:
+      return errors.read()
+
+  def statistics(self):
+    lines = lambda: [line for line in self.output().splitlines() if line.startswith("mqtt ")]
+    count = len(lines())
+    self.process.send_signal(signal.SIGUSR1)
+    if not waitFor(lambda: len(lines()) > count, 5):
+      return {}
+    return dict((name, int(value)) for value, name in re.findall(r"(\d+) (\w+)", lines()[-1]))
+
+  def stop(self):
+    self.input.close()
+    self.process.wait(10)
+
+  def kill(self):
+    self.process.kill()
+    self.process.wait()
+    self.input.close()
+
+def main():
+  if not os.access(MOSQUITTO, os.X_OK):
+    print("skip  mqtt checks, no mosquitto (set MOSQUITTO)")
+    return 0
+
+  work = tempfile.mkdtemp()
+  broker = Broker(work)
+  receiver = None
+  try:
+    subprocess.check_call([sys.executable, os.path.join(TEST, "capture.py"), "sensors", os.path.join(work, "sensors")])
+    with open(os.path.join(work, "sensors"), "rb") as file:
+      sensors = file.read()
+    with open(os.path.join(TEST, "mqtt.txt")) as file:
+      expected = file.read().splitlines()
+
+    broker.start()
+    watch = Subscriber(broker.port, "watch")
+    receiver = Receiver(work, broker.port, "qos=1")
+    check("online", waitFor(lambda: watch.received("status", "online"), 5))
+    receiver.feed(sensors)
+    waitFor(lambda: not watch.missing(expected), 10)
+    check("readings", not watch.missing(expected), ", ".join(watch.missing(expected)))
+    acknowledged = lambda statistics: (statistics.get("publishes", -1) == statistics.get("acknowledged")) and \
+      (statistics.get("queued") == 0)
+    waitFor(lambda: acknowledged(receiver.statistics()), 5)
+    check("acknowledged", acknowledged(receiver.statistics()), str(receiver.statistics()))
+
+    late = Subscriber(broker.port, "late")
+    waitFor(lambda: not late.missing(expected, True), 5)
+    check("retained", not late.missing(expected, True) and late.received("status", "online", True),
+      ", ".join(late.missing(expected, True)))
+    late.close()
+    watch.close()
+
+    # The restarted broker has no session and no retained messages left
+    broker.stop()
+    broker.start()
+    watch = Subscriber(broker.port, "watch")
+    receiver.feed(sensors)
+    waitFor(lambda: not watch.missing(expected), 20)
+    check("reconnect", not watch.missing(expected) and (receiver.statistics().get("connects") == 2),
+      str(receiver.statistics()))
+
+    receiver.kill()
+    receiver = None
+    check("will", waitFor(lambda: watch.received("status", "offline"), 5))
+
+    receiver = Receiver(work, broker.port, "qos=0,keepalive=5")
+    waitFor(lambda: watch.received("status", "online") >= 2, 5)
+    for i in range(2):
+      receiver.feed(sensors)
+    statistics = receiver.statistics()
+    check("keepalive", (statistics.get("connects") == 1) and ("no answer" not in receiver.output()),
+      str(statistics))
+    receiver.stop()
+    receiver = None
+    watch.close()
+  finally:
+    if receiver is not None:
+      receiver.kill()
+    broker.stop()
+    shutil.rmtree(work, ignore_errors=True)
+
+  return 1 if failed else 0
+
+sys.exit(main())
@@ -0,0 +1,128 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Pulse classifier checks: every length up to beyond the table is classified by the table lookup, the selected batch
+ * kernel and every other kernel exactly like a compare with the window limits, also at limits that do not fall on
+ * table entry boundaries. Run from the repository root with "make check".
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../PulseClass.h"
+
+// Lengths checked, beyond the table some longer ones
+#define LENGTHS  (PULSE_CLASS_MAX_LENGTH + 4096)
+
+// Windows with limits inside and on table entry boundaries (wt440h, pulse space, within one entry, open ended)
+static const struct {
+  uint32_t min;
+  uint32_t max;
+} windows[] = {
+  { 1500, 2200 },
+  { 1500, 2400 },
+  {  500, 1400 },
+  {  300,  700 },
+  { 1003, 1997 },
+  { 1001, 1005 },
+  {  100, PULSE_CLASS_UNLIMITED },
+  { 16000, PULSE_CLASS_MAX_LENGTH },
+  { 0, 7 },
+};
+#define WINDOW_COUNT  (sizeof(windows) / sizeof(windows[0]))
+
+static bool failed = false;
+
+static void Check(const char *name, bool ok, const char *details)
+{
+  printf("%-5s %s%s%s\n", ok ? "ok" : "FAIL", name, (ok || (details == NULL)) ? "" : ": ", ok ? "" : details);
+  failed = failed || !ok;
+}
+
+int main(void)
+{
+  static uint32_t samples[LENGTHS];
+  static PulseClassType classes[LENGTHS];
+  static PulseClassType expected[LENGTHS];
+  PulseClassType bits[WINDOW_COUNT];
+  char details[128] = "";
+  char benchmark[4096] = "";
+  bool lookup = true, batch = true;
+  FILE *stream;
+
+  for(size_t w = 0; w < WINDOW_COUNT; w++) {
+    bits[w] = PulseClassAdd(windows[w].min, windows[w].max);
+  }
+  for(uint32_t length = 0; length < LENGTHS; length++) {
+    // Mode bits must be ignored
+    samples[length] = length | ((length & 1) ? LIRC_MODE2_PULSE : LIRC_MODE2_SPACE);
+    expected[length] = 0;
+    for(size_t w = 0; w < WINDOW_COUNT; w++) {
+      if((length >= windows[w].min) && (length <= windows[w].max)) {
+        expected[length] |= bits[w];
+      }
+    }
+  }
+
+  for(uint32_t length = 0; length < LENGTHS; length++) {
+    if(lookup && (PulseClassify(length) != expected[length])) {
+      snprintf(details, sizeof(details), "length %u: %#x, expected %#x", length, PulseClassify(length),
+        expected[length]);
+      lookup = false;
+    }
+  }
+  Check("pulseclass lookup", lookup, details);
+
+  PulseClassifyBatch(samples, LENGTHS, classes);
+  for(uint32_t length = 0; length < LENGTHS; length++) {
+    if(batch && (classes[length] != expected[length])) {
+      snprintf(details, sizeof(details), "length %u: %#x, expected %#x", length, classes[length], expected[length]);
+      batch = false;
+    }
+  }
+  Check("pulseclass batch", batch, details);
+
+  // The benchmark compares every kernel with the table lookup
+  stream = fmemopen(benchmark, sizeof(benchmark) - 1, "w");
+  if(stream == NULL) {
+    perror("fmemopen()");
+    return EXIT_FAILURE;
+  }
+  PulseClassBenchmark(samples, LENGTHS, stream);
+  fclose(stream);
+  Check("pulseclass kernels", strstr(benchmark, "MISMATCH") == NULL, benchmark);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#!/bin/bash
+#
+# Replay checks: decode synthetic captures (see capture.py) and compare the readings with the expected ones, with one
+# and with several decoder threads. Run from the repository root after make, or with "make check".
+#
+
+TEST=$(dirname "$0")
+WEATHER_RX=${WEATHER_RX:-$TEST/../weather_rx}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+failed=0
+
+# compare <name> <expected readings> <weather_rx input options>
+compare() {
+  local name=$1 expected=$2
+
+  for threads in 1 3; do
+    if "$WEATHER_RX" -j $threads $3 2>/dev/null | diff -u "$expected" - > "$WORK/$name.diff"; then
+      echo "ok    $name (-j $threads)"
+    else
+      echo "FAIL  $name (-j $threads)"
+      cat "$WORK/$name.diff"
+      failed=1
+    fi
+  done
+}
+
+# check <name> <capture.py arguments> <expected readings>
+check() {
+  python3 "$TEST/capture.py" $2 "$WORK/$1.bin" ${4:-} || exit 1
+  compare $1 "$3" "-r $WORK/$1.bin"
+}
+
+# archive <name> <capture.py arguments> <expected readings>: the same after recording the capture to a pulse archive
+archive() {
+  python3 "$TEST/capture.py" $2 "$WORK/$1.bin" ${4:-} || exit 1
+  "$WEATHER_RX" -r "$WORK/$1.bin" -w "$WORK/$1.wrxa" > /dev/null 2>&1 || exit 1
+  compare $1 "$3" "-a $WORK/$1.wrxa"
+}
+
+# Every protocol, two rounds of three copies
+check sensors sensors "$TEST/sensors.txt" 2
+# Repeats back to back in one stream are decoded one by one, also without a checksum or a preamble
+check burst burst "$TEST/sensors.txt" 2
+# Noise bits before every frame: only protocols with a preamble and a checksum find their frames behind them
+check prefixed prefixed "$TEST/prefixed.txt" 2
+# Carrier frequency reports between the pulses are no part of the pulse stream, neither live nor in an archive
+check carrier carrier "$TEST/sensors.txt" 2
+archive archive carrier "$TEST/sensors.txt" 2
+# Random biphase noise must not decode to anything
+check noise noise /dev/null 1
+
+exit $failed
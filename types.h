@@ -35,12 +35,44 @@
 #define TYPES_H_
 
 #include <stdint.h>
+#include <linux/lirc.h>
 
 // Bit definitions
 #define BIT_ZERO                  0
 #define BIT_ONE                   1
 #define BIT_IN_STREAM             2
 #define BIT_VALID                 4
+// Bit stream interrupted, carries no bit
+#define BIT_END                   8
 typedef uint8_t BitType;
 
+// Bit mask of pulse length classes (see PulseClass.h)
+typedef uint32_t PulseClassType;
+
+// Pulse kind flags
+#define PULSE_SPACE               0
+#define PULSE_MARK                1
+// Receiver timeout, a space ending the signal
+#define PULSE_TIMEOUT             2
+
+// Received pulse or space
+typedef struct {
+  // Length in us
+  uint32_t length;
+  // Length classes the pulse belongs to
+  PulseClassType classes;
+  // Mark, space or timeout
+  uint8_t kind;
+} PulseType;
+
+// LIRC mode2 sample format, for kernel headers without it
+#ifndef LIRC_MODE2_MASK
+#define LIRC_MODE2_SPACE          0x00000000
+#define LIRC_MODE2_PULSE          0x01000000
+#define LIRC_MODE2_FREQUENCY      0x02000000
+#define LIRC_MODE2_TIMEOUT        0x03000000
+#define LIRC_VALUE_MASK           0x00FFFFFF
+#define LIRC_MODE2_MASK           0xFF000000
+#endif
+
 #endif // TYPES_H_
@@ -34,66 +34,592 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
 
 #include "types.h"
 #include "config.h"
-#include "wt440h.h"
-#include "auriol.h"
-#include "rf_tech.h"
-#include "mebus.h"
-#include "ws1700.h"
-#include "gt9000.h"
+#include "PulseInput.h"
+#include "Decoder.h"
+#include "PulseArchive.h"
+#include "ConfigFile.h"
+#include "Pipeline.h"
+#include "Replay.h"
+#include "PulseClass.h"
+#include "OutputFormat.h"
+#include "ShmRing.h"
+#include "Fhem.h"
+#include "Mqtt.h"
 
-// Pulse length bits in lirc data
-#define LIRC_LENGTH_MASK  0xFFFFFF
+// Maximum number of receivers served by one process
+#define MAX_RECEIVERS     PIPELINE_MAX_RECEIVERS
+
+// Receiver: one lirc device with its own set of decoders
+typedef struct {
+  // Device file name
+  const char *name;
+  // Tag printed in front of the decoded messages (NULL: no tag)
+  const char *tag;
+  // Input
+  PulseInputContext input;
+  // Decoders (replay)
+  DecoderContext decoder;
+} ReceiverType;
+
+// Settings of the configuration file
+typedef struct {
+  // Protocol selection, timing, confirmation and threads
+  DecoderConfigType *decoder;
+  // Output formats and files, NULL for text on standard output
+  char *output;
+  // FHEM server address, NULL if messages are not sent to FHEM
+  char *fhem;
+  // MQTT server address and options, NULL if readings are not published
+  char *mqtt;
+} SettingsType;
+
+// Statistics print request
+static volatile sig_atomic_t statisticsRequest = 0;
+// Termination request
+static volatile sig_atomic_t terminateRequest = 0;
+
+/***********************************************************************************************************************
+ * Signal handler for statistics print request
+ **********************************************************************************************************************/
+static void StatisticsSignalHandler(int signum)
+{
+  (void)signum;
+  statisticsRequest = 1;
+}
+
+/***********************************************************************************************************************
+ * Signal handler for termination request
+ **********************************************************************************************************************/
+static void TerminateSignalHandler(int signum)
+{
+  (void)signum;
+  terminateRequest = 1;
+}
+
+/***********************************************************************************************************************
+ * Print usage
+ **********************************************************************************************************************/
+static void PrintUsage(const char *name)
+{
+  fprintf(stderr,
+    "Usage: %s [-c config] [-p protocols] [-f profile] [-m confirm] [-j threads] [-s assign] [-l] [-o outputs]\n"
+    "       [-q queues] [-F host[:port]] [-M host[:port][,option=value ...]] [-b]\n"
+    "       [-r capture | -a archive [-t start]] [-w archive] [[tag=]lirc device ...]\n"
+    "  -c config     Read settings (protocols = ..., timing = ..., confirm = ..., threads = ..., assign = ...,\n"
+    "                output = ..., queue = ..., fhem = ..., mqtt = ...) from a configuration file\n"
+    "  -p protocols  Comma separated list of protocols to decode or \"all\", +name / -name changes the selection\n"
+    "  -f profile    Timing profile: digital or analog (signal through the analog filter)\n"
+    "  -m confirm    Confirmation policies as protocol=policy list, policy is first (first valid message),\n"
+    "                <n>-of-<m> (n identical among the last m messages) or majority-of-<m>, default is 2-of-2\n"
+    "  -j threads    Number of decoder threads for live decoding and capture replay\n"
+    "  -s assign     Decoder threads of the protocols as protocol=thread list (counted from 0), protocols not\n"
+    "                listed are spread over the threads\n"
+    "  -l            List the protocols, their confirmation policy and decoder thread, selected ones are marked\n"
+    "                with '*'\n"
+    "  -o outputs    Comma separated list of output formats with optional file: text, json (JSON Lines) or binary\n"
+    "                (fixed size records), e.g. text,json=readings.json (default: text on standard output).\n"
+    "                shm[=name] publishes the readings into the shared memory ring /dev/shm/name\n"
+    "                (default " SHM_RING_DEFAULT_NAME ") for local readers such as weather_tail\n"
+    "  -q queues     Queue policies of the outputs as output=policy[:slots] list (e.g. fhem=drop-newest:64), policy\n"
+    "                is block, drop-oldest or drop-newest. Default: block for replay, drop-oldest for live decoding\n"
+    "  -F host:port  Also send the readings to FHEM over its telnet port (default port " FHEM_DEFAULT_PORT ")\n"
+    "  -M host:port  Also publish the readings to an MQTT server (default port " MQTT_DEFAULT_PORT ") as retained\n"
+    "                values of prefix/protocol/id[/channel]/quantity. Options: prefix (default "
+    MQTT_DEFAULT_PREFIX "),\n"
+    "                client (default " MQTT_DEFAULT_CLIENT "), qos (0 or 1, default 1), keepalive (s), user, password\n"
+    "  -b            Benchmark the pulse classifier kernels with the samples of the capture given with -r\n"
+    "  -r capture    Replay a recorded capture file instead of reading the lirc device\n"
+    "  -a archive    Replay a compact pulse archive instead of reading the lirc device\n"
+    "  -t start      Start archive replay at this time (seconds since epoch)\n"
+    "  -w archive    Record received pulses into a compact pulse archive (single receiver only)\n"
+    "Messages are prefixed with the receiver tag if given. If more than one device is given, the device file name is\n"
+    "used as default tag.\n",
+    name);
+}
+
+/***********************************************************************************************************************
+ * Apply a setting of the configuration file
+ **********************************************************************************************************************/
+static bool ConfigHandler(void *ctx, const char *key, const char *value)
+{
+  SettingsType *settings = ctx;
+  DecoderConfigType *config = settings->decoder;
+  bool retval = false;
+
+  if(!strcmp(key, "protocols")) {
+    retval = DecoderConfigProtocols(config, value);
+  }
+  else if(!strcmp(key, "timing")) {
+    retval = DecoderConfigTiming(config, value);
+  }
+  else if(!strcmp(key, "confirm")) {
+    retval = DecoderConfigConfirm(config, value);
+  }
+  else if(!strcmp(key, "threads")) {
+    retval = DecoderConfigThreads(config, value);
+  }
+  else if(!strcmp(key, "assign")) {
+    retval = DecoderConfigAssign(config, value);
+  }
+  else if(!strcmp(key, "output")) {
+    free(settings->output);
+    settings->output = strdup(value);
+    retval = (settings->output != NULL);
+  }
+  else if(!strcmp(key, "queue")) {
+    retval = OutputConfigQueues(value);
+  }
+  else if(!strcmp(key, "fhem")) {
+    free(settings->fhem);
+    settings->fhem = strdup(value);
+    retval = (settings->fhem != NULL);
+  }
+  else if(!strcmp(key, "mqtt")) {
+    free(settings->mqtt);
+    settings->mqtt = strdup(value);
+    retval = (settings->mqtt != NULL);
+  }
+
+  return retval;
+}
+
+/***********************************************************************************************************************
+ * Read all available samples of a receiver and decode them (replay).
+ * Returns false on end of file.
+ **********************************************************************************************************************/
+static bool ReceiverService(ReceiverType *rx, PulseArchiveWriter *recorder)
+{
+  // Received samples
+  const uint32_t *lircBuffer;
+  // Number of samples read at once
+  ssize_t samples;
+
+  // Read all available data from lirc
+  samples = PulseInputRead(&rx->input, &lircBuffer);
+  if(samples < 0) {
+    if(errno != EINTR) {
+      perror(rx->name);
+      exit(EXIT_FAILURE);
+    }
+    return true;
+  }
+  // End of file
+  else if(samples == 0) {
+    return false;
+  }
+
+  // Resynchronize time stamps at archive sync points
+  if(rx->input.syncTime != 0) {
+    TimeStampSync(&rx->decoder.clock, rx->input.syncTime);
+  }
+
+  // Record samples
+  if((recorder != NULL) && !PulseArchiveWriterWrite(recorder, lircBuffer, samples)) {
+    perror("archive");
+    exit(EXIT_FAILURE);
+  }
+
+  // Process the whole batch
+  DecoderProcess(&rx->decoder, lircBuffer, samples);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Print statistics of all receivers
+ **********************************************************************************************************************/
+static void PrintStatistics(ReceiverType *receivers, int count, PipelineType *pipeline, FhemContext *fhem,
+  MqttContext *mqtt)
+{
+  for(int i = 0; i < count; i++) {
+    PulseInputPrintStatistics(&receivers[i].input, receivers[i].tag ? receivers[i].tag : receivers[i].name, stderr);
+  }
+  // Replay decodes in the reading thread, there is no pipeline
+  if(pipeline != NULL) {
+    PipelinePrintStatistics(pipeline, stderr);
+  }
+  OutputPrintStatistics(stderr);
+  if(fhem != NULL) {
+    FhemPrintStatistics(fhem, stderr);
+  }
+  if(mqtt != NULL) {
+    MqttPrintStatistics(mqtt, stderr);
+  }
+}
+
+/***********************************************************************************************************************
+ * Get monotonic time in seconds
+ **********************************************************************************************************************/
+static double GetSeconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
 
 /***********************************************************************************************************************
  * Main
  **********************************************************************************************************************/
 int main(int argc, char *argv[])
 {
-  // Lirc Device file name
-  char *lircName = DEFAULT_LIRC_DEV;
-  // LIRC Device file descriptor
-  int lircDev;
-  // Data from lirc driver
-  uint32_t lircData;
-
-  // Check lirc devide name exists on command line
-  if(argc == 2) {
-    lircName = argv[1];
-  }
-
-  // Open device file for reading
-  lircDev = open(lircName, O_RDONLY);
-  if(lircDev == -1) {
-    perror("open()");
+  // Receivers
+  static ReceiverType receivers[MAX_RECEIVERS];
+  int receiverCount = 0;
+  // Capture file name for replay
+  char *replayName = NULL;
+  // Archive file name for replay
+  char *archiveName = NULL;
+  // Archive replay start time in us
+  uint64_t archiveStart = 0;
+  // Archive file name for recording
+  char *recordName = NULL;
+  // Archive recorder
+  static PulseArchiveWriter recorder;
+  // Protocol selection and timing profile
+  DecoderConfigType decoderConfig;
+  // Settings beyond the decoders
+  SettingsType settings = { .decoder = &decoderConfig, .output = NULL, .fhem = NULL, .mqtt = NULL };
+  // FHEM connection
+  static FhemContext fhem;
+  // MQTT connection
+  static MqttContext mqtt;
+  // List protocols only
+  bool listProtocols = false;
+  // Benchmark the pulse classifier only
+  bool benchmark = false;
+  // Replay start time
+  double replayStart = 0;
+  // Signal handlers (no SA_RESTART, read() shall return on signal)
+  struct sigaction sa = { .sa_handler = StatisticsSignalHandler };
+  struct sigaction saTerm = { .sa_handler = TerminateSignalHandler };
+  int opt;
+
+  // Parse command line, settings are applied in order so later ones override earlier ones
+  DecoderConfigDefault(&decoderConfig);
+  while((opt = getopt(argc, argv, "c:p:f:m:j:s:lo:q:F:M:br:a:t:w:")) != -1) {
+    switch(opt) {
+      case 'c': {
+        if(!ConfigFileRead(optarg, ConfigHandler, &settings)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'p': {
+        if(!DecoderConfigProtocols(&decoderConfig, optarg)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'f': {
+        if(!DecoderConfigTiming(&decoderConfig, optarg)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'm': {
+        if(!DecoderConfigConfirm(&decoderConfig, optarg)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'j': {
+        if(!DecoderConfigThreads(&decoderConfig, optarg)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 's': {
+        if(!DecoderConfigAssign(&decoderConfig, optarg)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'l': {
+        listProtocols = true;
+      }
+      break;
+
+      case 'o': {
+        free(settings.output);
+        settings.output = strdup(optarg);
+        if(settings.output == NULL) {
+          perror("strdup()");
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'q': {
+        if(!OutputConfigQueues(optarg)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'F': {
+        free(settings.fhem);
+        settings.fhem = strdup(optarg);
+        if(settings.fhem == NULL) {
+          perror("strdup()");
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'M': {
+        free(settings.mqtt);
+        settings.mqtt = strdup(optarg);
+        if(settings.mqtt == NULL) {
+          perror("strdup()");
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'b': {
+        benchmark = true;
+      }
+      break;
+
+      case 'r': {
+        replayName = optarg;
+      }
+      break;
+
+      case 'a': {
+        archiveName = optarg;
+      }
+      break;
+
+      case 't': {
+        char *end;
+        double start = strtod(optarg, &end);
+
+        // Also rejects NaN and values beyond the microsecond time stamps
+        if((*optarg == 0) || (*end != 0) || !(start >= 0) || !(start <= (double)(UINT64_MAX / 1000000))) {
+          fprintf(stderr, "Invalid archive start time: %s (seconds)\n", optarg);
+          PrintUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        archiveStart = start * 1000000;
+      }
+      break;
+
+      case 'w': {
+        recordName = optarg;
+      }
+      break;
+
+      default: {
+        PrintUsage(argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    }
+  }
+
+  if(!DecoderConfigCheck(&decoderConfig)) {
+    exit(EXIT_FAILURE);
+  }
+  if(benchmark && (replayName == NULL)) {
+    fprintf(stderr, "The benchmark needs a capture file (-r)\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Only list protocols
+  if(listProtocols) {
+    DecoderPrintProtocols(&decoderConfig, stdout);
+    exit(EXIT_SUCCESS);
+  }
+
+  // Lirc devices with optional tags from the command line
+  for(int i = optind; i < argc; i++) {
+    char *separator = strchr(argv[i], '=');
+    if(receiverCount >= MAX_RECEIVERS) {
+      fprintf(stderr, "Too many receivers (max. %u)\n", MAX_RECEIVERS);
+      exit(EXIT_FAILURE);
+    }
+    if(separator != NULL) {
+      *separator = 0;
+      receivers[receiverCount].tag = argv[i];
+      receivers[receiverCount].name = separator + 1;
+    }
+    else {
+      receivers[receiverCount].name = argv[i];
+      // Several receivers must be told apart, use the device file name without path
+      if((argc - optind) > 1) {
+        char *baseName = strrchr(argv[i], '/');
+        receivers[receiverCount].tag = (baseName != NULL) ? (baseName + 1) : argv[i];
+      }
+    }
+    receiverCount++;
+  }
+  // Default lirc device
+  if(receiverCount == 0) {
+    receivers[receiverCount++].name = DEFAULT_LIRC_DEV;
+  }
+
+  // Replay and recording is done with one receiver only
+  if(((replayName != NULL) || (archiveName != NULL) || (recordName != NULL)) && (receiverCount > 1)) {
+    fprintf(stderr, "Replay and recording is only possible with a single receiver\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Open capture file for replay
+  if(replayName != NULL) {
+    receivers[0].name = replayName;
+    if(!PulseInputOpenReplay(&receivers[0].input, replayName)) {
+      perror(replayName);
+      exit(EXIT_FAILURE);
+    }
+    replayStart = GetSeconds();
+  }
+  // Open archive for replay
+  else if(archiveName != NULL) {
+    receivers[0].name = archiveName;
+    if(!PulseInputOpenArchive(&receivers[0].input, archiveName, archiveStart)) {
+      fprintf(stderr, "%s: Cannot open archive\n", archiveName);
+      exit(EXIT_FAILURE);
+    }
+    replayStart = GetSeconds();
+  }
+  // Open device files for reading
+  else {
+    for(int i = 0; i < receiverCount; i++) {
+      if(!PulseInputOpenDevice(&receivers[i].input, receivers[i].name)) {
+        perror(receivers[i].name);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  // Initialize replay decoders, time stamps are derived from the recorded pulse lengths. Live decoders belong to the
+  // decoder threads.
+  if((replayName != NULL) || (archiveName != NULL)) {
+    DecoderInit(&receivers[0].decoder, receivers[0].tag, TimeStampPulseTime, &decoderConfig, NULL);
+  }
+
+  // Benchmark the classifier with the pulse classes of the selected protocols
+  if(benchmark) {
+    PulseClassBenchmark(receivers[0].input.map, receivers[0].input.mapSamples, stdout);
+    exit(EXIT_SUCCESS);
+  }
+
+  // Create archive for recording
+  if((recordName != NULL) &&
+     !PulseArchiveWriterOpen(&recorder, recordName, (replayName != NULL) || (archiveName != NULL))) {
+    perror(recordName);
+    exit(EXIT_FAILURE);
+  }
+
+  // Output sinks, the readings are only formatted for the enabled ones
+  if(!OutputFormatConfig((settings.output != NULL) ? settings.output : "text")) {
     exit(EXIT_FAILURE);
   }
+  // Send the readings to FHEM as well
+  if(settings.fhem != NULL) {
+    OutputSinkType sink;
+
+    if(!FhemInit(&fhem, settings.fhem)) {
+      exit(EXIT_FAILURE);
+    }
+    sink = FhemSink(&fhem);
+    OutputAddSink(&sink);
+  }
+  // Publish the readings to MQTT as well
+  if(settings.mqtt != NULL) {
+    OutputSinkType sink;
 
-  // Receive and decode messages
-  while(1) {
-    // Wait and read data from lirc
-    if(read(lircDev, &lircData, sizeof(lircData)) != sizeof(lircData)) {
-      perror("read()");
+    if(!MqttInit(&mqtt, settings.mqtt)) {
       exit(EXIT_FAILURE);
     }
-    // Leave only the pulse length information
-    lircData &= LIRC_LENGTH_MASK;
-
-    // WT440H Messages
-    WT440hProcess(lircData);
-    // Auriol Messages
-    AuriolProcess(lircData);
-    // Mebus Messages
-    MebusProcess(lircData);
-    // RF-Tech Messages
-    RFTechProcess(lircData);
-    // WS 1700 Messages
-    Ws1700Process(lircData);
-    // GT-9000 Remote
-    GT9000Process(lircData);
+    sink = MqttSink(&mqtt);
+    OutputAddSink(&sink);
+  }
+  // Every sink gets its own queue and thread. Replay waits for slow sinks, live decoding must never be stalled by them.
+  OutputStart(((replayName != NULL) || (archiveName != NULL)) ? OutputBlock : OutputDropOldest);
+
+  // Print statistics on SIGUSR1
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGUSR1, &sa, NULL);
+  // Terminate gracefully on SIGINT and SIGTERM (the archive must be closed)
+  sigemptyset(&saTerm.sa_mask);
+  sigaction(SIGINT, &saTerm, NULL);
+  sigaction(SIGTERM, &saTerm, NULL);
+
+  // Capture replay with more decoder threads: decode the capture in pieces split at long spaces
+  if((replayName != NULL) && (decoderConfig.threads > 1) && (recordName == NULL)) {
+    ReplayParallel(receivers[0].input.map, receivers[0].input.mapSamples, receivers[0].tag, &decoderConfig,
+      &terminateRequest);
+    receivers[0].input.samples = receivers[0].input.mapSamples;
+  }
+  // Replay: read and decode in one thread, as fast as possible
+  else if((replayName != NULL) || (archiveName != NULL)) {
+    while(!terminateRequest && ReceiverService(&receivers[0], (recordName != NULL) ? &recorder : NULL)) {
+      OutputFlush();
+      // Print statistics if requested
+      if(statisticsRequest) {
+        statisticsRequest = 0;
+        PrintStatistics(receivers, receiverCount, NULL, (settings.fhem != NULL) ? &fhem : NULL,
+          (settings.mqtt != NULL) ? &mqtt : NULL);
+      }
+    }
+  }
+  // Live: read, decode and print in separate threads
+  else {
+    static PipelineType pipeline;
+    PipelineReceiverType sources[MAX_RECEIVERS];
+
+    for(int i = 0; i < receiverCount; i++) {
+      sources[i].name = receivers[i].name;
+      sources[i].tag = receivers[i].tag;
+      sources[i].input = &receivers[i].input;
+    }
+    PipelineStart(&pipeline, sources, receiverCount, &decoderConfig, (recordName != NULL) ? &recorder : NULL);
+    while(!terminateRequest && PipelineService(&pipeline)) {
+      OutputFlush();
+      // Print statistics if requested
+      if(statisticsRequest) {
+        statisticsRequest = 0;
+        PrintStatistics(receivers, receiverCount, &pipeline, (settings.fhem != NULL) ? &fhem : NULL,
+          (settings.mqtt != NULL) ? &mqtt : NULL);
+      }
+    }
+    PipelineStop(&pipeline);
+  }
+
+  // Write and send the last readings
+  OutputClose();
+
+  // Finish recording
+  if((recordName != NULL) && !PulseArchiveWriterClose(&recorder)) {
+    perror(recordName);
+    exit(EXIT_FAILURE);
+  }
+
+  // Print replay throughput
+  if((replayName != NULL) || (archiveName != NULL)) {
+    double elapsed = GetSeconds() - replayStart;
+    fprintf(stderr, "replay: %llu samples in %.3f s, %.0f samples/s\n", (unsigned long long)receivers[0].input.samples,
+      elapsed, (elapsed > 0) ? receivers[0].input.samples / elapsed : 0.0);
+  }
+
+  for(int i = 0; i < receiverCount; i++) {
+    DecoderFree(&receivers[i].decoder);
+    PulseInputClose(&receivers[i].input);
   }
 
   return 0;
@@ -0,0 +1,169 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Weather Station Receiver / Decoder for Raspberry Pi
+ *
+ * (C) 2015 Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "Output.h"
+#include "ShmRing.h"
+
+// Poll interval while following an idle ring in ms
+#define POLL_INTERVAL     10
+
+/***********************************************************************************************************************
+ * Print usage
+ **********************************************************************************************************************/
+static void PrintUsage(const char *name)
+{
+  fprintf(stderr,
+    "Usage: %s [-n count] [-f] [ring]\n"
+    "  -n count  Start with the last count readings in the ring (default 10)\n"
+    "  -f        Follow the ring and print new readings as they arrive\n"
+    "Prints the readings weather_rx publishes into the shared memory ring /dev/shm/ring (default "
+    SHM_RING_DEFAULT_NAME ").\n",
+    name);
+}
+
+/***********************************************************************************************************************
+ * Print a reading: sequence number, time, tag, protocol and the fields it has
+ **********************************************************************************************************************/
+static void PrintRecord(const ShmRingRecordType *record)
+{
+  static const char *quantities[QuantityCount] = { "temperature", "humidity", "switch" };
+
+  printf("%u %llu.%06llu", record->sequence, (unsigned long long)(record->end / 1000000),
+    (unsigned long long)(record->end % 1000000));
+  if(record->tag[0] != 0) {
+    printf(" %s", record->tag);
+  }
+  printf(" %s", record->protocol);
+  if(record->id >= 0) {
+    printf(" id=%d", record->id);
+  }
+  if(record->channel >= 0) {
+    printf(" channel=%d", record->channel);
+  }
+  if(record->battery != BatteryUnknown) {
+    printf(" battery=%s", (record->battery == BatteryLow) ? "low" : "ok");
+  }
+  for(unsigned q = 0; q < QuantityCount; q++) {
+    if(record->present & (1 << q)) {
+      // Temperature in 0.1 degrees
+      if(q == QuantityTemperature) {
+        char temperature[16];
+
+        OutputTenths(temperature, sizeof(temperature), record->values[q]);
+        printf(" %s=%s", quantities[q], temperature);
+      }
+      else {
+        printf(" %s=%d", quantities[q], record->values[q]);
+      }
+    }
+  }
+  printf(" frame=%0*llx\n", (record->frameLength + 3) / 4, (unsigned long long)record->frame);
+}
+
+/***********************************************************************************************************************
+ * Main
+ **********************************************************************************************************************/
+int main(int argc, char *argv[])
+{
+  // Ring and reader
+  const char *name = SHM_RING_DEFAULT_NAME;
+  ShmRingReader reader;
+  ShmRingRecordType record;
+  // Readings printed before following, follow the ring
+  unsigned long backlog = 10;
+  bool follow = false;
+  // Lost readings already reported
+  uint64_t lost = 0;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:f")) != -1) {
+    switch(opt) {
+      case 'n': {
+        char *end;
+        backlog = strtoul(optarg, &end, 0);
+        if((*optarg == 0) || (*end != 0)) {
+          PrintUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+
+      case 'f': {
+        follow = true;
+      }
+      break;
+
+      default: {
+        PrintUsage(argv[0]);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  if(optind < (argc - 1)) {
+    PrintUsage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  if(optind < argc) {
+    name = argv[optind];
+  }
+
+  if(!ShmRingReaderOpen(&reader, name, (backlog > SHM_RING_SLOTS) ? SHM_RING_SLOTS : backlog)) {
+    perror(name);
+    exit(EXIT_FAILURE);
+  }
+
+  do {
+    // Take everything there is, no system calls until the ring is drained
+    while(ShmRingRead(&reader, &record)) {
+      PrintRecord(&record);
+    }
+    if(reader.lost != lost) {
+      fprintf(stderr, "%s: %llu readings lost\n", name, (unsigned long long)(reader.lost - lost));
+      lost = reader.lost;
+    }
+    fflush(stdout);
+
+    if(follow) {
+      struct timespec delay = { .tv_sec = 0, .tv_nsec = POLL_INTERVAL * 1000000L };
+      nanosleep(&delay, NULL);
+    }
+  } while(follow);
+
+  ShmRingReaderClose(&reader);
+
+  return EXIT_SUCCESS;
+}
@@ -37,12 +37,16 @@
 #include "config.h"
 #ifdef MODULE_WS1700_ENABLE
 
-#include "types.h"
+#include "Protocol.h"
 
-void Ws1700Process(uint32_t pulseLength);
+// Protocol descriptions of the variants
+#ifdef MODULE_WS1700_VARIANT_WS1700
+extern const ProtocolType ws1700Protocol;
+#endif
+#ifdef MODULE_WS1700_VARIANT_GT_WT_01
+extern const ProtocolType gtwt01Protocol;
+#endif
 
-#else // MODULE_WS1700_ENABLE
-#define Ws1700Process(x)
 #endif // MODULE_WS1700_ENABLE
 
 #endif // WS1700_H_
@@ -37,12 +37,11 @@
 #include "config.h"
 #ifdef MODULE_WT440H_ENABLE
 
-#include <stdint.h>
+#include "Protocol.h"
 
-void WT440hProcess(uint32_t lircData);
+// Protocol description
+extern const ProtocolType wt440hProtocol;
 
-#else // MODULE_WT440H_ENABLE
-#define WT440hProcess(x)
 #endif // MODULE_WT440H_ENABLE
 
 #endif // WT440H_H_